@@ -0,0 +1,97 @@
+######################################################################
+# Automatically generated by qmake (3.0) Mon Dec 25 15:21:45 2017
+######################################################################
+
+TEMPLATE = app
+TARGET = qsrun
+INCLUDEPATH += .
+
+# Input
+HEADERS += arithmeticevaluator.h \
+           calculationengine.h \
+           calculatorcheck.h \
+           calculatorinterface.h \
+           calculatorsearchprovider.h \
+           cancellationtoken.h \
+           commandhistory.h \
+           contentindex.h \
+           contentindexer.h \
+           contentsearchprovider.h \
+           directorylister.h \
+           entrylauncher.h \
+           entryprovider.h \
+           entrypushbutton.h \
+           entrysearchprovider.h \
+           entrystore.h \
+           executesearchprovider.h \
+           fileindexer.h \
+           filenameindex.h \
+           filesearchprovider.h \
+           headlessrunner.h \
+           historysearchprovider.h \
+           iconthemeindex.h \
+           latencybenchmark.h \
+           memoryaccounting.h \
+           matchbenchmark.h \
+           metrics.h \
+           pathsearchprovider.h \
+           persistencequeue.h \
+           pixmapcache.h \
+           searchdispatcher.h \
+           searchprovider.h \
+           settingsprovider.h \
+           singleinstanceserver.h \
+           stallwatchdog.h \
+           taskscheduler.h \
+           window.h
+SOURCES += arithmeticevaluator.cpp \
+           calculationengine.cpp \
+           calculatorcheck.cpp \
+           calculatorsearchprovider.cpp \
+           commandhistory.cpp \
+           contentindex.cpp \
+           contentindexer.cpp \
+           contentsearchprovider.cpp \
+           directorylister.cpp \
+           entrylauncher.cpp \
+           entryprovider.cpp \
+           entrypushbutton.cpp \
+           entrysearchprovider.cpp \
+           entrystore.cpp \
+           executesearchprovider.cpp \
+           fileindexer.cpp \
+           filenameindex.cpp \
+           filesearchprovider.cpp \
+           headlessrunner.cpp \
+           historysearchprovider.cpp \
+           iconthemeindex.cpp \
+           latencybenchmark.cpp \
+           memoryaccounting.cpp \
+           matchbenchmark.cpp \
+           metrics.cpp \
+           main.cpp \
+           pathsearchprovider.cpp \
+           persistencequeue.cpp \
+           pixmapcache.cpp \
+           searchdispatcher.cpp \
+           searchprovider.cpp \
+           settingsprovider.cpp \
+           singleinstanceserver.cpp \
+           stallwatchdog.cpp \
+           taskscheduler.cpp \
+           window.cpp
+QT += widgets sql network concurrent
+CONFIG += c++17
+# Count every heap allocation for /memory, qmake CONFIG+=allocation_counting
+allocation_counting: DEFINES += QSRUN_ALLOCATION_COUNTING
+isEmpty(PLUGINDIR): PLUGINDIR = /usr/lib/qsrun
+DEFINES += QSRUN_PLUGIN_DIR=\\\"$$PLUGINDIR\\\"
+# "make check" runs the calculator corpus, against the plugin too once calculator/ is built
+check.commands = ./$$TARGET --calculator-check
+check.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += check
+# "make latency-check", optionally against an earlier report: make latency-check LATENCY_BASELINE=file
+latency.target = latency-check
+latency.commands = ./$$TARGET --latency-bench $(if $(LATENCY_BASELINE),--latency-baseline=$(LATENCY_BASELINE))
+latency.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += latency
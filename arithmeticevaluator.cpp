@@ -0,0 +1,336 @@
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include "arithmeticevaluator.h"
+
+/* Largest integer exponent for ^, anything above overflows 64 bits anyway (except for 0, 1 and -1) */
+static const int MAX_EXPONENT = 64;
+
+bool ArithmeticEvaluator::normalize(Rational &value)
+{
+	/* INT64_MIN has no positive counterpart, which gcd and negation would need */
+	if(value.denominator == 0 || value.numerator == INT64_MIN || value.denominator == INT64_MIN)
+	{
+		return false;
+	}
+	if(value.denominator < 0)
+	{
+		value.numerator = -value.numerator;
+		value.denominator = -value.denominator;
+	}
+	qint64 divisor = std::gcd(value.numerator, value.denominator);
+	if(divisor > 1)
+	{
+		value.numerator /= divisor;
+		value.denominator /= divisor;
+	}
+	return true;
+}
+
+bool ArithmeticEvaluator::add(Rational a, Rational b, Rational &result)
+{
+	qint64 left, right, denominator;
+	if(__builtin_mul_overflow(a.numerator, b.denominator, &left) ||
+	   __builtin_mul_overflow(b.numerator, a.denominator, &right) ||
+	   __builtin_mul_overflow(a.denominator, b.denominator, &denominator) ||
+	   __builtin_add_overflow(left, right, &result.numerator))
+	{
+		return false;
+	}
+	result.denominator = denominator;
+	return normalize(result);
+}
+
+bool ArithmeticEvaluator::multiply(Rational a, Rational b, Rational &result)
+{
+	/* Cross-reduce first, to stay within 64 bits for longer */
+	qint64 g1 = std::gcd(a.numerator, b.denominator);
+	qint64 g2 = std::gcd(b.numerator, a.denominator);
+	if(g1 > 1)
+	{
+		a.numerator /= g1;
+		b.denominator /= g1;
+	}
+	if(g2 > 1)
+	{
+		b.numerator /= g2;
+		a.denominator /= g2;
+	}
+	if(__builtin_mul_overflow(a.numerator, b.numerator, &result.numerator) ||
+	   __builtin_mul_overflow(a.denominator, b.denominator, &result.denominator))
+	{
+		return false;
+	}
+	return normalize(result);
+}
+
+bool ArithmeticEvaluator::divide(Rational a, Rational b, Rational &result)
+{
+	if(b.numerator == 0)
+	{
+		return false;
+	}
+	return multiply(a, {b.denominator, b.numerator}, result);
+}
+
+ArithmeticEvaluator::Rational ArithmeticEvaluator::fail()
+{
+	this->failed = true;
+	return {0, 1};
+}
+
+void ArithmeticEvaluator::skipSpaces()
+{
+	while(this->position != this->end && this->position->isSpace())
+	{
+		++this->position;
+	}
+}
+
+bool ArithmeticEvaluator::accept(QChar c)
+{
+	skipSpaces();
+	if(this->position != this->end && *this->position == c)
+	{
+		++this->position;
+		return true;
+	}
+	return false;
+}
+
+/* expression := term (('+' | '-') term)* */
+ArithmeticEvaluator::Rational ArithmeticEvaluator::expression()
+{
+	Rational result = term();
+	while(!this->failed)
+	{
+		bool plus = accept('+');
+		if(!plus && !accept('-'))
+		{
+			break;
+		}
+		Rational operand = term();
+		if(!plus)
+		{
+			if(operand.numerator == INT64_MIN)
+			{
+				return fail();
+			}
+			operand.numerator = -operand.numerator;
+		}
+		if(!add(result, operand, result))
+		{
+			return fail();
+		}
+	}
+	return result;
+}
+
+/* term := unary (('*' | '/') unary)* */
+ArithmeticEvaluator::Rational ArithmeticEvaluator::term()
+{
+	Rational result = unary();
+	while(!this->failed)
+	{
+		bool times = accept('*') || accept(QChar(0x00D7));
+		if(!times && !accept('/') && !accept(QChar(0x00F7)))
+		{
+			break;
+		}
+		/* "**" is a power for libqalculate */
+		if(times && this->position != this->end && *this->position == '*')
+		{
+			return fail();
+		}
+		Rational operand = unary();
+		if(this->failed || !(times ? multiply(result, operand, result) : divide(result, operand, result)))
+		{
+			return fail();
+		}
+	}
+	return result;
+}
+
+/* unary := ('-' | '+') unary | power, so -2^2 is -(2^2) */
+ArithmeticEvaluator::Rational ArithmeticEvaluator::unary()
+{
+	if(accept('-'))
+	{
+		Rational operand = unary();
+		if(operand.numerator == INT64_MIN)
+		{
+			return fail();
+		}
+		return {-operand.numerator, operand.denominator};
+	}
+	if(accept('+'))
+	{
+		return unary();
+	}
+	return power();
+}
+
+/* power := primary ('^' unary)?, right associative */
+ArithmeticEvaluator::Rational ArithmeticEvaluator::power()
+{
+	Rational base = primary();
+	if(this->failed || !accept('^'))
+	{
+		return base;
+	}
+	Rational exponent = unary();
+	/* Roots are not rational in general */
+	if(this->failed || exponent.denominator != 1 || exponent.numerator > MAX_EXPONENT ||
+	   exponent.numerator < -MAX_EXPONENT)
+	{
+		return fail();
+	}
+	int n = static_cast<int>(exponent.numerator);
+	if(n < 0)
+	{
+		if(base.numerator == 0)
+		{
+			return fail();
+		}
+		base = {base.denominator, base.numerator};
+		if(!normalize(base))
+		{
+			return fail();
+		}
+		n = -n;
+	}
+	Rational result{1, 1};
+	for(int i = 0; i < n; i++)
+	{
+		if(!multiply(result, base, result))
+		{
+			return fail();
+		}
+	}
+	return result;
+}
+
+/* primary := number | '(' expression ')' */
+ArithmeticEvaluator::Rational ArithmeticEvaluator::primary()
+{
+	if(accept('('))
+	{
+		Rational result = expression();
+		if(this->failed || !accept(')'))
+		{
+			return fail();
+		}
+		return result;
+	}
+	return number();
+}
+
+/* number := digits ('.' digits)?, exact, so 0.1 is 1/10 */
+ArithmeticEvaluator::Rational ArithmeticEvaluator::number()
+{
+	skipSpaces();
+	Rational result{0, 1};
+	bool digits = false;
+	bool fraction = false;
+	while(this->position != this->end)
+	{
+		QChar c = *this->position;
+		if(c == '.' && !fraction)
+		{
+			fraction = true;
+		}
+		else if(c >= '0' && c <= '9')
+		{
+			digits = true;
+			if(__builtin_mul_overflow(result.numerator, 10, &result.numerator) ||
+			   __builtin_add_overflow(result.numerator, c.unicode() - '0', &result.numerator) ||
+			   (fraction && __builtin_mul_overflow(result.denominator, 10, &result.denominator)))
+			{
+				return fail();
+			}
+		}
+		else
+		{
+			break;
+		}
+		++this->position;
+	}
+	/* Also catches identifiers, units and everything else we leave to libqalculate */
+	if(!digits || !normalize(result))
+	{
+		return fail();
+	}
+	return result;
+}
+
+/* As a decimal, if it terminates within MAX_DIGITS digits */
+bool ArithmeticEvaluator::format(Rational value, QString &result)
+{
+	/* Terminating means the denominator has no prime factors but 2 and 5 */
+	qint64 denominator = value.denominator;
+	int twos = 0;
+	int fives = 0;
+	while(denominator % 2 == 0)
+	{
+		denominator /= 2;
+		twos++;
+	}
+	while(denominator % 5 == 0)
+	{
+		denominator /= 5;
+		fives++;
+	}
+	if(denominator != 1)
+	{
+		return false;
+	}
+	int decimals = std::max(twos, fives);
+	if(decimals > MAX_DIGITS)
+	{
+		return false;
+	}
+	/* numerator * (10^decimals / denominator) is the value shifted by decimals digits */
+	qint64 factor = 1;
+	for(int i = 0; i < decimals; i++)
+	{
+		factor *= 10;
+	}
+	qint64 scaled;
+	if(__builtin_mul_overflow(value.numerator, factor / value.denominator, &scaled) || scaled == INT64_MIN)
+	{
+		return false;
+	}
+	bool negative = scaled < 0;
+	QString digits = QString::number(negative ? -scaled : scaled);
+	if(digits.size() < decimals + 1)
+	{
+		digits.prepend(QString(decimals + 1 - digits.size(), '0'));
+	}
+	/* Longer ones, and tiny ones, are printed in exponent notation by libqalculate */
+	int integerDigits = digits.size() - decimals;
+	bool tiny = value.numerator != 0 && std::abs(static_cast<double>(value.numerator) / value.denominator) < 0.001;
+	if(digits.size() > MAX_DIGITS || tiny)
+	{
+		return false;
+	}
+	if(decimals > 0)
+	{
+		digits.insert(integerDigits, '.');
+	}
+	result = negative ? "-" + digits : digits;
+	return true;
+}
+
+bool ArithmeticEvaluator::evaluate(const QString &expression, QString &result)
+{
+	ArithmeticEvaluator evaluator;
+	evaluator.position = expression.constData();
+	evaluator.end = evaluator.position + expression.size();
+	Rational value = evaluator.expression();
+	evaluator.skipSpaces();
+	if(evaluator.failed || evaluator.position != evaluator.end)
+	{
+		return false;
+	}
+	return format(value, result);
+}
@@ -0,0 +1,47 @@
+#ifndef ARITHMETICEVALUATOR_H
+#define ARITHMETICEVALUATOR_H
+#include <QString>
+
+/* Exact evaluation of plain arithmetic (numbers, + - * / ^ and parentheses) with 64 bit
+ * rationals, without allocating while parsing.
+ *
+ * Anything else (units, functions, variables, overflow, results that are not a short terminating
+ * decimal) is left to libqalculate, by returning false. Results are printed the way libqalculate
+ * prints them with the options CalculationEngine uses. */
+class ArithmeticEvaluator
+{
+  private:
+	struct Rational
+	{
+		qint64 numerator;
+		qint64 denominator;
+	};
+
+	const QChar *position;
+	const QChar *end;
+	bool failed = false;
+
+	void skipSpaces();
+	bool accept(QChar c);
+	Rational fail();
+	Rational expression();
+	Rational term();
+	Rational unary();
+	Rational power();
+	Rational primary();
+	Rational number();
+
+	static bool normalize(Rational &value);
+	static bool add(Rational a, Rational b, Rational &result);
+	static bool multiply(Rational a, Rational b, Rational &result);
+	static bool divide(Rational a, Rational b, Rational &result);
+	static bool format(Rational value, QString &result);
+
+  public:
+	/* Longest decimal we print ourselves, in digits (the precision CalculationEngine uses) */
+	static const int MAX_DIGITS = 16;
+
+	static bool evaluate(const QString &expression, QString &result);
+};
+
+#endif // ARITHMETICEVALUATOR_H
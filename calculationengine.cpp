@@ -13,44 +13,123 @@
  * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPluginLoader>
+#include <QDebug>
+#include <atomic>
+#include "arithmeticevaluator.h"
 #include "calculationengine.h"
+#include "memoryaccounting.h"
+#include "metrics.h"
 
+#ifndef QSRUN_PLUGIN_DIR
+#define QSRUN_PLUGIN_DIR "/usr/lib/qsrun"
+#endif
 
-CalculationEngine::CalculationEngine()
+static const char *CALCULATOR_PLUGIN_FILE = "libqsrun-calculator.so";
+static std::atomic<bool> pluginLoaded{false};
+
+/* Next to the binary when run from the build directory, then the install location */
+QStringList CalculationEngine::pluginCandidates()
 {
-	if (!CALCULATOR)
+	QStringList result;
+	const QString pluginFile = QString::fromLatin1(CALCULATOR_PLUGIN_FILE);
+	QString overrideDir = qEnvironmentVariable("QSRUN_PLUGIN_DIR");
+	if(!overrideDir.isEmpty())
 	{
-		new Calculator();
-		CALCULATOR->terminateThreads();
-		CALCULATOR->setPrecision(16);
+		result.append(overrideDir + "/" + pluginFile);
 	}
+	const QString appDir = QCoreApplication::applicationDirPath();
+	result.append(appDir + "/calculator/" + pluginFile);
+	result.append(appDir + "/../lib/qsrun/" + pluginFile);
+	result.append(QString::fromLatin1(QSRUN_PLUGIN_DIR) + "/" + pluginFile);
+	return result;
+}
 
-	//stolen from krunner's qalculate engine
-	/*eo.auto_post_conversion = POST_CONVERSION_BEST;
-	eo.keep_zero_units = false;
-
-	eo.parse_options.angle_unit = ANGLE_UNIT_RADIANS;
-	eo.structuring = STRUCTURING_SIMPLIFY;
+/* Loads the plugin on the first call. Returns nullptr if it was built without
+ * or could not be loaded, in which case we do not try again */
+CalculatorInterface *CalculationEngine::calculator()
+{
+	static QMutex loaderMutex;
+	static bool attempted = false;
+	static CalculatorInterface *instance = nullptr;
 
-	// suggested in https://github.com/Qalculate/libqalculate/issues/16
-	// to avoid memory overflow for seemingly innocent calculations (Bug 277011)
-	eo.approximation = APPROXIMATION_APPROXIMATE;
+	QMutexLocker locker(&loaderMutex);
+	if(attempted)
+	{
+		return instance;
+	}
+	attempted = true;
+	AllocationScope allocations(MemoryAccounting::CALCULATOR);
 
-	po.number_fraction_format = FRACTION_DECIMAL;
-	po.indicate_infinite_series = false;
-	po.use_all_prefixes = false;
-	po.use_denominator_prefix = true;
-	po.negative_exponents = false;
-	po.lower_case_e = true;
-	po.base_display = BASE_DISPLAY_NORMAL;*/
+	QElapsedTimer timer;
+	timer.start();
+	for(const QString &path : pluginCandidates())
+	{
+		if(!QFileInfo::exists(path))
+		{
+			continue;
+		}
+		/* Not deleted on purpose, the plugin stays loaded for the rest of the session */
+		QPluginLoader *loader = new QPluginLoader(path);
+		instance = qobject_cast<CalculatorInterface *>(loader->instance());
+		if(instance != nullptr)
+		{
+			Metrics::instance().set("calculator.plugin_load_ms", timer.elapsed());
+			pluginLoaded = true;
+			return instance;
+		}
+		qWarning() << "Failed to load calculator plugin" << path << ":" << loader->errorString();
+		delete loader;
+	}
+	qWarning() << "No calculator plugin found, only plain arithmetic is available";
+	return nullptr;
 }
 
 QString CalculationEngine::evaluate(const QString &expression)
 {
-	CALCULATOR->terminateThreads();
-	QByteArray ba = expression.toLatin1();
-	const char *ctext = ba.data();
-	MathStructure result = CALCULATOR->calculate(ctext, this->eo);
-	result.format(po);
-	return result.print(po).c_str();
+	QString result;
+	if(ArithmeticEvaluator::evaluate(expression, result))
+	{
+		Metrics::instance().add("calculator.fast_path");
+		/* Differential check, to catch where we print something else than libqalculate */
+		static const bool verify = qEnvironmentVariableIsSet("QSRUN_CALC_VERIFY");
+		if(verify && calculator() != nullptr)
+		{
+			QString expected = evaluateWithPlugin(expression);
+			if(expected != result)
+			{
+				qWarning() << "Fast path mismatch for" << expression << ":" << result << "instead of" << expected;
+				return expected;
+			}
+		}
+		return result;
+	}
+	Metrics::instance().add("calculator.qalculate");
+	return evaluateWithPlugin(expression);
+}
+
+QString CalculationEngine::evaluateWithPlugin(const QString &expression)
+{
+	CalculatorInterface *plugin = calculator();
+	if(plugin == nullptr)
+	{
+		return QCoreApplication::translate("CalculationEngine", "Calculator plugin not available");
+	}
+	AllocationScope allocations(MemoryAccounting::CALCULATOR);
+	return plugin->evaluate(expression);
+}
+
+bool CalculationEngine::isPluginLoaded()
+{
+	return pluginLoaded;
+}
+
+bool CalculationEngine::isPluginAvailable()
+{
+	return calculator() != nullptr;
 }
@@ -16,22 +16,24 @@
 #ifndef CALCULATIONENGINE_H
 #define CALCULATIONENGINE_H
 #include <QString>
-#include <libqalculate/Calculator.h>
-#include <libqalculate/ExpressionItem.h>
-#include <libqalculate/Unit.h>
-#include <libqalculate/Prefix.h>
-#include <libqalculate/Variable.h>
-#include <libqalculate/Function.h>
+#include <QStringList>
+#include "calculatorinterface.h"
 
+/* Evaluates calculator queries. Plain arithmetic is handled by ArithmeticEvaluator,
+ * everything else by the calculator plugin, which is only loaded when first needed. */
 class CalculationEngine
 {
-private:
-	EvaluationOptions eo;
-	PrintOptions po;
+  private:
+	static QStringList pluginCandidates();
+	static CalculatorInterface *calculator();
 
-public:
-	CalculationEngine();
+  public:
 	QString evaluate(const QString &expression);
+	/* Bypasses the fast path, for comparing against it */
+	QString evaluateWithPlugin(const QString &expression);
+	static bool isPluginLoaded();
+	/* Loads the plugin if that was not attempted yet */
+	static bool isPluginAvailable();
 };
 
 #endif // CALCULATIONENGINE_H
@@ -0,0 +1,19 @@
+# libqalculate backed calculator, loaded by qsrun on the first "=" query
+
+TEMPLATE = lib
+TARGET = qsrun-calculator
+CONFIG += plugin c++17
+INCLUDEPATH += . ..
+
+HEADERS += ../calculatorinterface.h \
+           qalculatecalculator.h
+SOURCES += qalculatecalculator.cpp
+
+QT_CONFIG -= no-pkg-config
+LIBS += -lcln
+CONFIG += link_pkgconfig
+PKGCONFIG += libqalculate
+
+isEmpty(PLUGINDIR): PLUGINDIR = /usr/lib/qsrun
+target.path = $$PLUGINDIR
+INSTALLS += target
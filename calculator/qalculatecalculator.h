@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2018-2019 Albert S. <mail at quitesimple dot org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef QALCULATECALCULATOR_H
+#define QALCULATECALCULATOR_H
+#include <QObject>
+#include <libqalculate/Calculator.h>
+#include <libqalculate/ExpressionItem.h>
+#include <libqalculate/Unit.h>
+#include <libqalculate/Prefix.h>
+#include <libqalculate/Variable.h>
+#include <libqalculate/Function.h>
+#include "calculatorinterface.h"
+
+class QalculateCalculator : public QObject, public CalculatorInterface
+{
+	Q_OBJECT
+	Q_PLUGIN_METADATA(IID CalculatorInterface_iid)
+	Q_INTERFACES(CalculatorInterface)
+
+  private:
+	EvaluationOptions eo;
+	PrintOptions po;
+
+  public:
+	QalculateCalculator();
+	QString evaluate(const QString &expression) override;
+};
+
+#endif // QALCULATECALCULATOR_H
@@ -0,0 +1,94 @@
+#include <QPair>
+#include <QVector>
+#include "arithmeticevaluator.h"
+#include "calculationengine.h"
+#include "calculatorcheck.h"
+
+/* Expression and what libqalculate prints for it. Empty if the fast path must leave it to
+ * libqalculate, because it is not plain arithmetic or the result would not be printed as a
+ * short decimal */
+static const QVector<QPair<QString, QString>> CORPUS = {
+	/* Precedence and associativity */
+	{"1+2*3", "7"},
+	{"(1+2)*3", "9"},
+	{"10-2-3", "5"},
+	{"8/2/2", "2"},
+	{"2^3^2", "512"},
+	{"2*3^2", "18"},
+	/* Unary minus binds weaker than ^ */
+	{"-2^2", "-4"},
+	{"(-2)^2", "4"},
+	{"2^-1", "0.5"},
+	{"-2^-2", "-0.25"},
+	{"3--2", "5"},
+	/* Exact decimals */
+	{"0.1+0.2", "0.3"},
+	{"17/4", "4.25"},
+	{"1/8", "0.125"},
+	{"1-1", "0"},
+	{"1/3", ""},
+	{"2^0.5", ""},
+	/* Large integers, up to 16 digits */
+	{"1234567890123456", "1234567890123456"},
+	{"999999999999999+1", "1000000000000000"},
+	{"12345678901234567", ""},
+	{"9223372036854775807", ""},
+	{"4611686018427387904*2", ""},
+	{"2^62", ""},
+	{"2^53", "9007199254740992"},
+	/* 16 significant digits after the point */
+	{"0.123456789012345", "0.123456789012345"},
+	{"0.1234567890123456", ""},
+	/* Below 0.001, libqalculate switches to exponent notation */
+	{"0.001", "0.001"},
+	{"1/1000", "0.001"},
+	{"-0.001", "-0.001"},
+	{"0.0009", ""},
+	{"1/1024", ""},
+	/* Not plain arithmetic */
+	{"2**3", ""},
+	{"3 2", ""},
+	{"2 m + 3 m", ""},
+	{"sqrt(4)", ""},
+	{"1/0", ""},
+};
+
+CalculatorCheck::CalculatorCheck() : out(stdout)
+{
+}
+
+int CalculatorCheck::run()
+{
+	CalculationEngine engine;
+	const bool withPlugin = CalculationEngine::isPluginAvailable();
+	int failures = 0;
+	for(const QPair<QString, QString> &entry : CORPUS)
+	{
+		const QString &expression = entry.first;
+		const QString &expected = entry.second;
+		QString result;
+		if(!ArithmeticEvaluator::evaluate(expression, result))
+		{
+			result.clear();
+		}
+		if(result != expected)
+		{
+			this->out << "FAIL\t" << expression << "\texpected \"" << expected << "\", fast path gave \"" << result
+					  << "\"" << Qt::endl;
+			failures++;
+		}
+		if(withPlugin && !expected.isEmpty())
+		{
+			QString reference = engine.evaluateWithPlugin(expression);
+			if(reference != expected)
+			{
+				this->out << "FAIL\t" << expression << "\texpected \"" << expected << "\", libqalculate gave \""
+						  << reference << "\"" << Qt::endl;
+				failures++;
+			}
+		}
+	}
+	this->out << CORPUS.size() << " expressions, " << failures << " failures"
+			  << (withPlugin ? "" : " (calculator plugin not available, fast path only)") << Qt::endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#ifndef CALCULATORCHECK_H
+#define CALCULATORCHECK_H
+#include <QTextStream>
+
+/* Runs a fixed corpus of expressions through ArithmeticEvaluator and compares the results with
+ * what libqalculate prints for them. With the calculator plugin available, the expectations are
+ * checked against it as well. Headless, exits non-zero on any mismatch */
+class CalculatorCheck
+{
+  private:
+	QTextStream out;
+
+  public:
+	CalculatorCheck();
+	int run();
+};
+
+#endif // CALCULATORCHECK_H
@@ -0,0 +1,19 @@
+#ifndef CALCULATORINTERFACE_H
+#define CALCULATORINTERFACE_H
+#include <QString>
+#include <QtPlugin>
+
+/* Implemented by the calculator plugin, which keeps libqalculate (and cln)
+ * out of the qsrun binary. Loaded on demand by CalculationEngine. */
+class CalculatorInterface
+{
+  public:
+	virtual ~CalculatorInterface() = default;
+	/* May be called from several search threads */
+	virtual QString evaluate(const QString &expression) = 0;
+};
+
+#define CalculatorInterface_iid "org.quitesimple.qsrun.CalculatorInterface/1.0"
+Q_DECLARE_INTERFACE(CalculatorInterface, CalculatorInterface_iid)
+
+#endif // CALCULATORINTERFACE_H
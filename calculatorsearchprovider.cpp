@@ -0,0 +1,32 @@
+#include "calculatorsearchprovider.h"
+
+QString CalculatorSearchProvider::name() const
+{
+	return "calculator";
+}
+
+int CalculatorSearchProvider::latencyBudget() const
+{
+	return 2000;
+}
+
+bool CalculatorSearchProvider::handles(const QString &query) const
+{
+	return isCalculationQuery(query);
+}
+
+void CalculatorSearchProvider::search(const QString &query, const CancellationToken &token,
+									  const SearchResultCallback &emitResults)
+{
+	QString expression = query.mid(1);
+	QString value = calcEngine.evaluate(expression);
+	if(token.isCancelled())
+	{
+		return;
+	}
+	SearchResult result;
+	result.kind = SearchResult::CALCULATION;
+	result.expression = expression;
+	result.value = value;
+	emitResults({result});
+}
@@ -0,0 +1,20 @@
+#ifndef CALCULATORSEARCHPROVIDER_H
+#define CALCULATORSEARCHPROVIDER_H
+#include "calculationengine.h"
+#include "searchprovider.h"
+
+/* Evaluates queries starting with '=' */
+class CalculatorSearchProvider : public SearchProvider
+{
+  private:
+	CalculationEngine calcEngine;
+
+  public:
+	QString name() const override;
+	int latencyBudget() const override;
+	bool handles(const QString &query) const override;
+	void search(const QString &query, const CancellationToken &token,
+				const SearchResultCallback &emitResults) override;
+};
+
+#endif // CALCULATORSEARCHPROVIDER_H
@@ -0,0 +1,34 @@
+#ifndef CANCELLATIONTOKEN_H
+#define CANCELLATIONTOKEN_H
+#include <QDeadlineTimer>
+#include <atomic>
+#include <memory>
+
+/* Cooperative cancellation for work running on other threads. Copies share the cancellation
+ * state, but each copy can carry its own deadline, after which it counts as cancelled too. */
+class CancellationToken
+{
+  private:
+	std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+	QDeadlineTimer deadline{QDeadlineTimer::Forever};
+
+  public:
+	void cancel()
+	{
+		cancelled->store(true, std::memory_order_relaxed);
+	}
+
+	bool isCancelled() const
+	{
+		return cancelled->load(std::memory_order_relaxed) || deadline.hasExpired();
+	}
+
+	CancellationToken withDeadline(qint64 msecs) const
+	{
+		CancellationToken result = *this;
+		result.deadline = QDeadlineTimer(msecs);
+		return result;
+	}
+};
+
+#endif // CANCELLATIONTOKEN_H
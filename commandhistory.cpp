@@ -0,0 +1,222 @@
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include "commandhistory.h"
+#include "memoryaccounting.h"
+
+/* After this many days, a use counts half */
+static const double HALF_LIFE_DAYS = 14;
+
+CommandHistory::CommandHistory(QString filePath)
+{
+	this->filePath = filePath;
+}
+
+void CommandHistory::addUnlocked(const QString &line, qint64 count, qint64 lastUsed)
+{
+	auto it = this->ids.constFind(line);
+	if(it != this->ids.constEnd())
+	{
+		Command &command = this->commands[it.value()];
+		command.count += count;
+		command.lastUsed = std::max(command.lastUsed, lastUsed);
+	}
+	else
+	{
+		int id = this->commands.size();
+		this->commands.append({line, count, lastUsed});
+		this->ids.insert(line, id);
+	}
+	/* A command only ever gains weight, so it can only move up in the lists along its path */
+	const int id = this->ids.value(line);
+	const double commandWeight = weight(this->commands[id]);
+	int node = 0;
+	for(int depth = 0;; depth++)
+	{
+		QVector<int> &top = this->nodes[node].top;
+		top.removeOne(id);
+		int position = 0;
+		while(position < top.size() && weight(this->commands[top[position]]) >= commandWeight)
+		{
+			position++;
+		}
+		if(position < TOP_COMMANDS_PER_NODE)
+		{
+			top.insert(position, id);
+			if(top.size() > TOP_COMMANDS_PER_NODE)
+			{
+				top.removeLast();
+			}
+		}
+		if(depth == line.size())
+		{
+			break;
+		}
+		const QChar c = line[depth];
+		int child = this->nodes[node].children.value(c, -1);
+		if(child < 0)
+		{
+			child = this->nodes.size();
+			this->nodes[node].children.insert(c, child);
+			this->nodes.append(Node());
+		}
+		node = child;
+	}
+	this->nodes[node].command = id;
+}
+
+void CommandHistory::rebuildUnlocked(QVector<Command> commands)
+{
+	/* Forget the least valuable ones beyond the limit */
+	if(commands.size() > MAX_COMMANDS)
+	{
+		std::sort(commands.begin(), commands.end(),
+				  [](const Command &a, const Command &b) { return weight(a) > weight(b); });
+		commands.resize(MAX_COMMANDS);
+	}
+	this->commands.clear();
+	this->ids.clear();
+	this->nodes = {Node()};
+	for(const Command &command : commands)
+	{
+		addUnlocked(command.line, command.count, command.lastUsed);
+	}
+}
+
+double CommandHistory::weight(const Command &command)
+{
+	/* count * 0.5^((now - lastUsed) / halfLife), without the now part */
+	return std::log(std::max<qint64>(1, command.count)) + command.lastUsed / 86400.0 / HALF_LIFE_DAYS * std::log(2.0);
+}
+
+void CommandHistory::load()
+{
+	AllocationScope allocations(MemoryAccounting::HISTORY);
+	QMutexLocker fileLocker(&this->fileMutex);
+	QFile file(this->filePath);
+	if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		this->loaded = true;
+		return;
+	}
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+	int lines = 0;
+	{
+		QWriteLocker locker(&this->lock);
+		while(!stream.atEnd())
+		{
+			QString line = stream.readLine();
+			QStringList fields = line.split('\t');
+			if(fields.size() < 3)
+			{
+				continue;
+			}
+			/* The command line itself may contain tabs */
+			QString commandLine = line.section('\t', 2);
+			addUnlocked(commandLine, fields[1].toLongLong(), fields[0].toLongLong());
+			++lines;
+		}
+		this->logLines = lines;
+	}
+	this->loaded = true;
+	fileLocker.unlock();
+	compact();
+}
+
+bool CommandHistory::compact()
+{
+	QMutexLocker fileLocker(&this->fileMutex);
+	QVector<Command> snapshot;
+	{
+		QWriteLocker locker(&this->lock);
+		if(this->logLines - this->commands.size() < COMPACTION_SLACK && this->commands.size() <= MAX_COMMANDS)
+		{
+			return true;
+		}
+		rebuildUnlocked(this->commands);
+		snapshot = this->commands;
+	}
+	QDir().mkpath(QFileInfo(this->filePath).absolutePath());
+	QSaveFile file(this->filePath);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		return false;
+	}
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+	for(const Command &command : snapshot)
+	{
+		stream << command.lastUsed << '\t' << command.count << '\t' << command.line << '\n';
+	}
+	stream.flush();
+	if(!file.commit())
+	{
+		qDebug() << "Failed to compact command history: " << file.errorString();
+		return false;
+	}
+	this->logLines = snapshot.size();
+	return true;
+}
+
+void CommandHistory::record(const QString &line)
+{
+	AllocationScope allocations(MemoryAccounting::HISTORY);
+	if(line.trimmed().isEmpty() || line.contains('\n'))
+	{
+		return;
+	}
+	qint64 now = QDateTime::currentSecsSinceEpoch();
+	QMutexLocker fileLocker(&this->fileMutex);
+	QDir().mkpath(QFileInfo(this->filePath).absolutePath());
+	QFile file(this->filePath);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+	{
+		qDebug() << "Failed to append to command history: " << file.errorString();
+		return;
+	}
+	file.write(QString("%1\t1\t%2\n").arg(now).arg(line).toUtf8());
+	++this->logLines;
+	/* Otherwise load() is still to come, or busy, and will count it */
+	if(this->loaded)
+	{
+		QWriteLocker locker(&this->lock);
+		addUnlocked(line, 1, now);
+	}
+}
+
+QStringList CommandHistory::suggestions(const QString &prefix, int limit) const
+{
+	QReadLocker locker(&this->lock);
+	int node = 0;
+	for(QChar c : prefix)
+	{
+		node = this->nodes[node].children.value(c, -1);
+		if(node < 0)
+		{
+			return {};
+		}
+	}
+
+	QStringList result;
+	const QVector<int> &top = this->nodes[node].top;
+	for(int i = 0; i < top.size() && i < limit; i++)
+	{
+		result.append(this->commands[top[i]].line);
+	}
+	return result;
+}
+
+QJsonObject CommandHistory::memoryReport() const
+{
+	QReadLocker locker(&this->lock);
+	return {{"commands", this->commands.size()},
+			{"trie_nodes", this->nodes.size()},
+			{"trie_bytes", static_cast<qint64>(this->nodes.capacity() * sizeof(Node))}};
+}
@@ -0,0 +1,69 @@
+#ifndef COMMANDHISTORY_H
+#define COMMANDHISTORY_H
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/* Command lines that have been run ad hoc (through "Execute:" and the like).
+ *
+ * The history file is an append-only log of "time<TAB>count<TAB>command line" lines, which is
+ * compacted to one line per command from time to time. In memory, the commands are kept in a
+ * prefix tree, so suggestions never touch the file. Every node knows the best commands below it,
+ * which works because the ranking's decay does not change the order of commands over time. */
+class CommandHistory
+{
+  private:
+	struct Command
+	{
+		QString line;
+		qint64 count;
+		qint64 lastUsed;
+	};
+	struct Node
+	{
+		QHash<QChar, int> children;
+		int command = -1;
+		/* The best commands below this node, best first */
+		QVector<int> top;
+	};
+
+	mutable QReadWriteLock lock;
+	QVector<Command> commands;
+	QHash<QString, int> ids;
+	QVector<Node> nodes{Node()};
+	/* Serializes appending and compacting */
+	QMutex fileMutex;
+	QString filePath;
+	int logLines = 0;
+	/* Until then, recorded commands are only appended, load() reads them from the log */
+	bool loaded = false;
+
+	void addUnlocked(const QString &line, qint64 count, qint64 lastUsed);
+	void rebuildUnlocked(QVector<Command> commands);
+	/* The logarithm of the decayed use count, up to a term that is the same for all commands */
+	static double weight(const Command &command);
+
+  public:
+	static const int MAX_COMMANDS = 1000;
+	/* The log is compacted once it has this many lines more than commands */
+	static const int COMPACTION_SLACK = 500;
+	/* The most suggestions() can return */
+	static const int TOP_COMMANDS_PER_NODE = 8;
+
+	CommandHistory(QString filePath);
+	void load();
+	/* Appends a single line to the log, cheap enough for the GUI thread */
+	void record(const QString &line);
+	/* Rewrites the log if it has grown too much, should not be called from the GUI thread */
+	bool compact();
+	/* The best ranked commands starting with prefix, best first */
+	QStringList suggestions(const QString &prefix, int limit) const;
+	/* Number of commands and the size of the prefix tree */
+	QJsonObject memoryReport() const;
+};
+
+#endif // COMMANDHISTORY_H
@@ -0,0 +1,471 @@
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QReadLocker>
+#include <QSaveFile>
+#include <QWriteLocker>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "contentindex.h"
+
+static const quint32 INDEX_FILE_MAGIC = 0x71737463; // "qstc"
+static const quint32 INDEX_FILE_VERSION = 1;
+/* How many terms the last, possibly incomplete, word of a query may expand to */
+static const int MAX_PREFIX_EXPANSIONS = 32;
+
+struct ContentIndex::Header
+{
+	quint32 magic;
+	quint32 version;
+	quint32 documentCount;
+	quint32 termCount;
+	quint64 totalTokens;
+	quint64 documentsOffset;
+	quint64 termsOffset;
+	quint64 stringsOffset;
+	quint64 postingsOffset;
+};
+
+struct ContentIndex::DocumentRecord
+{
+	quint64 pathOffset;
+	quint32 pathLength;
+	quint32 tokenCount;
+	qint64 mtime;
+};
+
+struct ContentIndex::TermRecord
+{
+	quint64 stringOffset;
+	quint64 postingsOffset;
+	quint32 stringLength;
+	quint32 postingsLength;
+	quint32 documentFrequency;
+	quint32 reserved;
+};
+
+static void appendVarint(QByteArray &out, quint32 value)
+{
+	while(value >= 0x80)
+	{
+		out.append(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	out.append(static_cast<char>(value));
+}
+
+static quint32 readVarint(const uchar *&ptr, const uchar *end)
+{
+	quint32 result = 0;
+	int shift = 0;
+	while(ptr < end && shift < 32)
+	{
+		uchar byte = *ptr++;
+		result |= static_cast<quint32>(byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+		{
+			break;
+		}
+		shift += 7;
+	}
+	return result;
+}
+
+template <class T> static void appendRaw(QByteArray &out, const T &value)
+{
+	out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+ContentIndex::~ContentIndex()
+{
+	close();
+}
+
+const ContentIndex::Header *ContentIndex::header() const
+{
+	return reinterpret_cast<const Header *>(this->data);
+}
+
+const ContentIndex::DocumentRecord *ContentIndex::documentRecords() const
+{
+	return reinterpret_cast<const DocumentRecord *>(this->data + header()->documentsOffset);
+}
+
+const ContentIndex::TermRecord *ContentIndex::termRecords() const
+{
+	return reinterpret_cast<const TermRecord *>(this->data + header()->termsOffset);
+}
+
+QByteArray ContentIndex::termAt(quint32 index) const
+{
+	const TermRecord &record = termRecords()[index];
+	return QByteArray::fromRawData(
+		reinterpret_cast<const char *>(this->data + header()->stringsOffset + record.stringOffset),
+		record.stringLength);
+}
+
+QString ContentIndex::pathAt(quint32 document) const
+{
+	const DocumentRecord &record = documentRecords()[document];
+	return QString::fromUtf8(
+		reinterpret_cast<const char *>(this->data + header()->stringsOffset + record.pathOffset), record.pathLength);
+}
+
+quint32 ContentIndex::lowerBound(const QByteArray &term) const
+{
+	quint32 low = 0;
+	quint32 high = header()->termCount;
+	while(low < high)
+	{
+		quint32 mid = low + (high - low) / 2;
+		if(termAt(mid) < term)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+void ContentIndex::decodePostings(const TermRecord &term,
+								  const std::function<void(quint32, quint32)> &callback) const
+{
+	const uchar *ptr = this->data + header()->postingsOffset + term.postingsOffset;
+	const uchar *end = ptr + term.postingsLength;
+	quint32 document = 0;
+	while(ptr < end)
+	{
+		document += readVarint(ptr, end);
+		quint32 frequency = readVarint(ptr, end);
+		/* Checked here rather than in open(), which would have to decode all postings */
+		if(document >= header()->documentCount)
+		{
+			break;
+		}
+		callback(document, frequency);
+	}
+}
+
+/* Whether length bytes at offset lie within [0, limit), without overflowing */
+static bool isInRange(quint64 offset, quint64 length, quint64 limit)
+{
+	return offset <= limit && length <= limit - offset;
+}
+
+bool ContentIndex::isValid(const uchar *data, qint64 size)
+{
+	const quint64 fileSize = size;
+	const Header *header = reinterpret_cast<const Header *>(data);
+	if(header->magic != INDEX_FILE_MAGIC || header->version != INDEX_FILE_VERSION)
+	{
+		return false;
+	}
+	/* The sections follow each other in this order */
+	if(header->documentsOffset < sizeof(Header) || header->documentsOffset % 8 != 0 ||
+	   header->termsOffset % 8 != 0 ||
+	   !isInRange(header->documentsOffset, quint64(header->documentCount) * sizeof(DocumentRecord),
+				  header->termsOffset) ||
+	   !isInRange(header->termsOffset, quint64(header->termCount) * sizeof(TermRecord), header->stringsOffset) ||
+	   header->stringsOffset > header->postingsOffset || header->postingsOffset > fileSize)
+	{
+		return false;
+	}
+	const quint64 stringsSize = header->postingsOffset - header->stringsOffset;
+	const quint64 postingsSize = fileSize - header->postingsOffset;
+	const DocumentRecord *documents = reinterpret_cast<const DocumentRecord *>(data + header->documentsOffset);
+	for(quint32 i = 0; i < header->documentCount; i++)
+	{
+		if(!isInRange(documents[i].pathOffset, documents[i].pathLength, stringsSize))
+		{
+			return false;
+		}
+	}
+	const TermRecord *terms = reinterpret_cast<const TermRecord *>(data + header->termsOffset);
+	for(quint32 i = 0; i < header->termCount; i++)
+	{
+		if(!isInRange(terms[i].stringOffset, terms[i].stringLength, stringsSize) ||
+		   !isInRange(terms[i].postingsOffset, terms[i].postingsLength, postingsSize))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ContentIndex::open(const QString &indexFilePath)
+{
+	QScopedPointer<QFile> newFile(new QFile(indexFilePath));
+	if(!newFile->open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	qint64 newSize = newFile->size();
+	if(newSize < static_cast<qint64>(sizeof(Header)))
+	{
+		return false;
+	}
+	const uchar *newData = newFile->map(0, newSize);
+	if(newData == nullptr)
+	{
+		return false;
+	}
+	if(!isValid(newData, newSize))
+	{
+		qDebug() << "Ignoring content index of unknown format or damaged: " << indexFilePath;
+		newFile->unmap(const_cast<uchar *>(newData));
+		return false;
+	}
+
+	QWriteLocker locker(&this->lock);
+	closeUnlocked();
+	this->file.swap(newFile);
+	this->data = newData;
+	this->size = newSize;
+	return true;
+}
+
+void ContentIndex::closeUnlocked()
+{
+	if(this->file)
+	{
+		this->file->unmap(const_cast<uchar *>(this->data));
+		this->file.reset();
+	}
+	this->data = nullptr;
+	this->size = 0;
+}
+
+void ContentIndex::close()
+{
+	QWriteLocker locker(&this->lock);
+	closeUnlocked();
+}
+
+QVector<ContentIndex::Document> ContentIndex::documents() const
+{
+	QReadLocker locker(&this->lock);
+	QVector<Document> result;
+	if(this->data == nullptr)
+	{
+		return result;
+	}
+	for(quint32 i = 0; i < header()->documentCount; i++)
+	{
+		Document document;
+		document.path = pathAt(i);
+		document.mtime = documentRecords()[i].mtime;
+		document.tokenCount = documentRecords()[i].tokenCount;
+		result.append(document);
+	}
+	return result;
+}
+
+void ContentIndex::forEachPosting(const std::function<void(const QByteArray &, quint32, quint32)> &callback) const
+{
+	QReadLocker locker(&this->lock);
+	if(this->data == nullptr)
+	{
+		return;
+	}
+	for(quint32 i = 0; i < header()->termCount; i++)
+	{
+		/* a deep copy, so it can outlive the mapping */
+		QByteArray rawTerm = termAt(i);
+		QByteArray term(rawTerm.constData(), rawTerm.size());
+		decodePostings(termRecords()[i],
+					   [&term, &callback](quint32 document, quint32 frequency) { callback(term, document, frequency); });
+	}
+}
+
+QVector<ContentIndex::Match> ContentIndex::search(const QString &query, int limit,
+												  const CancellationToken &token) const
+{
+	QVector<QByteArray> terms = tokenize(query);
+	if(terms.isEmpty())
+	{
+		return {};
+	}
+	QReadLocker locker(&this->lock);
+	if(this->data == nullptr || header()->documentCount == 0)
+	{
+		return {};
+	}
+
+	const double documentCount = header()->documentCount;
+	const double averageLength = std::max(1.0, header()->totalTokens / documentCount);
+	/* document -> number of matched query terms and accumulated score */
+	QHash<quint32, QPair<int, double>> scores;
+	auto addTerm = [&](quint32 termIndex, int queryTerm) {
+		const TermRecord &record = termRecords()[termIndex];
+		double df = record.documentFrequency;
+		double idf = std::log(1.0 + (documentCount - df + 0.5) / (df + 0.5));
+		decodePostings(record, [&](quint32 document, quint32 frequency) {
+			double length = documentRecords()[document].tokenCount;
+			/* BM25 */
+			double tf = frequency * 2.2 / (frequency + 1.2 * (0.25 + 0.75 * length / averageLength));
+			QPair<int, double> &entry = scores[document];
+			if(entry.first == queryTerm)
+			{
+				entry.first = queryTerm + 1;
+			}
+			entry.second += tf * idf;
+		});
+	};
+
+	for(int i = 0; i < terms.size(); i++)
+	{
+		if(token.isCancelled())
+		{
+			return {};
+		}
+		quint32 index = lowerBound(terms[i]);
+		bool isLast = i == terms.size() - 1;
+		if(!isLast)
+		{
+			if(index >= header()->termCount || termAt(index) != terms[i])
+			{
+				return {};
+			}
+			addTerm(index, i);
+			continue;
+		}
+		/* The last word may still be typed, so also take terms it is a prefix of */
+		for(int expansions = 0; index < header()->termCount && expansions < MAX_PREFIX_EXPANSIONS;
+			++index, ++expansions)
+		{
+			if(!termAt(index).startsWith(terms[i]))
+			{
+				break;
+			}
+			addTerm(index, i);
+		}
+	}
+
+	QVector<Match> result;
+	for(auto it = scores.constBegin(); it != scores.constEnd(); ++it)
+	{
+		/* Only documents that contain all words */
+		if(it.value().first == terms.size())
+		{
+			Match match;
+			match.path = pathAt(it.key());
+			match.score = it.value().second;
+			result.append(match);
+		}
+	}
+	std::sort(result.begin(), result.end(), [](const Match &a, const Match &b) {
+		if(a.score != b.score)
+		{
+			return a.score > b.score;
+		}
+		return a.path < b.path;
+	});
+	if(result.size() > limit)
+	{
+		result.resize(limit);
+	}
+	return result;
+}
+
+QVector<QByteArray> ContentIndex::tokenize(const QString &text)
+{
+	QVector<QByteArray> result;
+	int start = -1;
+	for(int i = 0; i <= text.length(); i++)
+	{
+		bool isWordChar = i < text.length() && text[i].isLetterOrNumber();
+		if(isWordChar && start == -1)
+		{
+			start = i;
+		}
+		else if(!isWordChar && start != -1)
+		{
+			int length = i - start;
+			if(length >= MIN_TOKEN_LENGTH && length <= MAX_TOKEN_LENGTH)
+			{
+				result.append(text.midRef(start, length).toString().toLower().toUtf8());
+			}
+			start = -1;
+		}
+	}
+	return result;
+}
+
+bool ContentIndex::write(const QString &indexFilePath, const QVector<Document> &documents,
+						 const Postings &postings)
+{
+	QByteArray strings;
+	QByteArray documentRecords;
+	quint64 totalTokens = 0;
+	for(const Document &document : documents)
+	{
+		QByteArray path = document.path.toUtf8();
+		DocumentRecord record;
+		record.pathOffset = strings.size();
+		record.pathLength = path.size();
+		record.tokenCount = document.tokenCount;
+		record.mtime = document.mtime;
+		strings.append(path);
+		appendRaw(documentRecords, record);
+		totalTokens += document.tokenCount;
+	}
+
+	QVector<QByteArray> terms = postings.keys().toVector();
+	std::sort(terms.begin(), terms.end());
+	QByteArray termRecords;
+	QByteArray encodedPostings;
+	for(const QByteArray &term : terms)
+	{
+		QVector<QPair<quint32, quint32>> list = postings[term];
+		std::sort(list.begin(), list.end());
+		TermRecord record;
+		std::memset(&record, 0, sizeof(record));
+		record.stringOffset = strings.size();
+		record.stringLength = term.size();
+		record.postingsOffset = encodedPostings.size();
+		record.documentFrequency = list.size();
+		quint32 previous = 0;
+		for(const QPair<quint32, quint32> &posting : list)
+		{
+			appendVarint(encodedPostings, posting.first - previous);
+			appendVarint(encodedPostings, posting.second);
+			previous = posting.first;
+		}
+		record.postingsLength = encodedPostings.size() - record.postingsOffset;
+		strings.append(term);
+		appendRaw(termRecords, record);
+	}
+	/* keep the records following the strings aligned */
+	while(strings.size() % 8 != 0)
+	{
+		strings.append('\0');
+	}
+
+	Header header;
+	header.magic = INDEX_FILE_MAGIC;
+	header.version = INDEX_FILE_VERSION;
+	header.documentCount = documents.size();
+	header.termCount = terms.size();
+	header.totalTokens = totalTokens;
+	header.documentsOffset = sizeof(Header);
+	header.termsOffset = header.documentsOffset + documentRecords.size();
+	header.stringsOffset = header.termsOffset + termRecords.size();
+	header.postingsOffset = header.stringsOffset + strings.size();
+
+	QDir().mkpath(QFileInfo(indexFilePath).absolutePath());
+	QSaveFile file(indexFilePath);
+	if(!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(documentRecords);
+	file.write(termRecords);
+	file.write(strings);
+	file.write(encodedPostings);
+	return file.commit();
+}
@@ -0,0 +1,70 @@
+#ifndef CONTENTINDEX_H
+#define CONTENTINDEX_H
+#include <QFile>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QScopedPointer>
+#include <QVector>
+#include <functional>
+#include "cancellationtoken.h"
+
+/* Inverted index of text documents, stored in a single file and memory-mapped for queries.
+ *
+ * Layout: header, document records, term records (sorted by term), a blob of UTF-8 strings for paths and terms,
+ * and the postings. Postings of a term are varint encoded pairs of (document id delta, term frequency). */
+class ContentIndex
+{
+  public:
+	class Document
+	{
+	  public:
+		QString path;
+		qint64 mtime = 0;
+		quint32 tokenCount = 0;
+	};
+	class Match
+	{
+	  public:
+		QString path;
+		double score = 0;
+	};
+	/* term -> (document id, term frequency), ascending by document id */
+	typedef QHash<QByteArray, QVector<QPair<quint32, quint32>>> Postings;
+
+	static const int MIN_TOKEN_LENGTH = 2;
+	static const int MAX_TOKEN_LENGTH = 64;
+
+  private:
+	struct Header;
+	struct DocumentRecord;
+	struct TermRecord;
+
+	mutable QReadWriteLock lock;
+	QScopedPointer<QFile> file;
+	const uchar *data = nullptr;
+	qint64 size = 0;
+
+	/* Whether every section and record of the file lies within it */
+	static bool isValid(const uchar *data, qint64 size);
+	const Header *header() const;
+	const DocumentRecord *documentRecords() const;
+	const TermRecord *termRecords() const;
+	QByteArray termAt(quint32 index) const;
+	QString pathAt(quint32 document) const;
+	quint32 lowerBound(const QByteArray &term) const;
+	void decodePostings(const TermRecord &term, const std::function<void(quint32, quint32)> &callback) const;
+	void closeUnlocked();
+
+  public:
+	~ContentIndex();
+	bool open(const QString &indexFilePath);
+	void close();
+	QVector<Document> documents() const;
+	void forEachPosting(const std::function<void(const QByteArray &, quint32, quint32)> &callback) const;
+	QVector<Match> search(const QString &query, int limit, const CancellationToken &token = {}) const;
+
+	static QVector<QByteArray> tokenize(const QString &text);
+	static bool write(const QString &indexFilePath, const QVector<Document> &documents, const Postings &postings);
+};
+
+#endif // CONTENTINDEX_H
@@ -0,0 +1,134 @@
+#include <QDebug>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <algorithm>
+#include "contentindexer.h"
+
+static const int UPDATE_INTERVAL_MSECS = 15 * 60 * 1000;
+static const int TOKENIZE_BATCH_SIZE = 32;
+static const qint64 MAX_DOCUMENT_SIZE = 4 * 1024 * 1024;
+
+ContentIndexer::ContentIndexer(QSharedPointer<ContentIndex> index, QStringList roots, QStringList extensions,
+							   QString indexFilePath, CancellationToken token)
+{
+	this->index = index;
+	this->roots = roots;
+	for(const QString &extension : extensions)
+	{
+		this->extensions.append(extension.toLower());
+	}
+	this->indexFilePath = indexFilePath;
+	this->token = token;
+}
+
+bool ContentIndexer::isIndexable(const QString &suffix, qint64 size) const
+{
+	return size <= MAX_DOCUMENT_SIZE && this->extensions.contains(suffix.toLower());
+}
+
+void ContentIndexer::start()
+{
+	this->index->open(this->indexFilePath);
+	this->timer = new QTimer(this);
+	connect(this->timer, &QTimer::timeout, this, &ContentIndexer::update);
+	this->timer->start(UPDATE_INTERVAL_MSECS);
+	update();
+}
+
+void ContentIndexer::update()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	QHash<QString, QPair<quint32, qint64>> previous;
+	QVector<ContentIndex::Document> previousDocuments = this->index->documents();
+	for(int i = 0; i < previousDocuments.size(); i++)
+	{
+		previous[previousDocuments[i].path] = {static_cast<quint32>(i), previousDocuments[i].mtime};
+	}
+
+	QVector<ContentIndex::Document> documents;
+	QVector<qint32> remap(previousDocuments.size(), -1);
+	QVector<int> changed;
+	for(const QString &root : this->roots)
+	{
+		QDirIterator it(root, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+		while(it.hasNext())
+		{
+			if(this->token.isCancelled())
+			{
+				return;
+			}
+			it.next();
+			QFileInfo info = it.fileInfo();
+			if(!isIndexable(info.suffix(), info.size()))
+			{
+				continue;
+			}
+			ContentIndex::Document document;
+			document.path = info.absoluteFilePath();
+			document.mtime = info.lastModified().toMSecsSinceEpoch();
+			auto old = previous.constFind(document.path);
+			if(old != previous.constEnd() && old.value().second == document.mtime)
+			{
+				document.tokenCount = previousDocuments[old.value().first].tokenCount;
+				remap[old.value().first] = documents.size();
+			}
+			else
+			{
+				changed.append(documents.size());
+			}
+			documents.append(document);
+		}
+	}
+	if(changed.isEmpty() && documents.size() == previousDocuments.size())
+	{
+		return;
+	}
+
+	ContentIndex::Postings postings;
+	this->index->forEachPosting([&postings, &remap](const QByteArray &term, quint32 document, quint32 frequency) {
+		if(remap[document] != -1)
+		{
+			postings[term].append({static_cast<quint32>(remap[document]), frequency});
+		}
+	});
+
+	for(int batchStart = 0; batchStart < changed.size(); batchStart += TOKENIZE_BATCH_SIZE)
+	{
+		if(this->token.isCancelled())
+		{
+			return;
+		}
+		int batchEnd = std::min(changed.size(), batchStart + TOKENIZE_BATCH_SIZE);
+		for(int i = batchStart; i < batchEnd; i++)
+		{
+			ContentIndex::Document &document = documents[changed[i]];
+			QFile file(document.path);
+			if(!file.open(QIODevice::ReadOnly))
+			{
+				continue;
+			}
+			QVector<QByteArray> tokens = ContentIndex::tokenize(QString::fromUtf8(file.readAll()));
+			QHash<QByteArray, quint32> frequencies;
+			for(const QByteArray &token : tokens)
+			{
+				++frequencies[token];
+			}
+			for(auto it = frequencies.constBegin(); it != frequencies.constEnd(); ++it)
+			{
+				postings[it.key()].append({static_cast<quint32>(changed[i]), it.value()});
+			}
+			document.tokenCount = tokens.size();
+		}
+	}
+
+	if(!ContentIndex::write(this->indexFilePath, documents, postings) || !this->index->open(this->indexFilePath))
+	{
+		qWarning() << "Failed to write content index to" << this->indexFilePath;
+		return;
+	}
+	qInfo() << "Content index updated:" << documents.size() << "documents," << changed.size() << "(re)read in"
+			<< timer.elapsed() << "ms";
+}
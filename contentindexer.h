@@ -0,0 +1,34 @@
+#ifndef CONTENTINDEXER_H
+#define CONTENTINDEXER_H
+#include <QObject>
+#include <QSharedPointer>
+#include <QTimer>
+#include "cancellationtoken.h"
+#include "contentindex.h"
+
+/* Builds the ContentIndex in its own low priority thread. Each update only reads documents whose
+ * mtime changed, the postings of the others are carried over from the current index. The index
+ * file itself is still written as a whole. */
+class ContentIndexer : public QObject
+{
+	Q_OBJECT
+  private:
+	QSharedPointer<ContentIndex> index;
+	QStringList roots;
+	QStringList extensions;
+	QString indexFilePath;
+	CancellationToken token;
+	QTimer *timer = nullptr;
+
+	bool isIndexable(const QString &suffix, qint64 size) const;
+
+  public:
+	ContentIndexer(QSharedPointer<ContentIndex> index, QStringList roots, QStringList extensions,
+				   QString indexFilePath, CancellationToken token);
+
+  public slots:
+	void start();
+	void update();
+};
+
+#endif // CONTENTINDEXER_H
@@ -0,0 +1,62 @@
+#include <QMimeDatabase>
+#include "contentsearchprovider.h"
+
+ContentSearchProvider::ContentSearchProvider(QStringList roots, QStringList extensions, QString indexFilePath)
+{
+	this->index.reset(new ContentIndex());
+	this->indexer = new ContentIndexer(this->index, roots, extensions, indexFilePath, this->indexerToken);
+	this->indexer->moveToThread(&this->indexerThread);
+	QObject::connect(&this->indexerThread, &QThread::started, this->indexer, &ContentIndexer::start);
+	/* Its timer belongs to that thread, so it must be deleted there */
+	QObject::connect(&this->indexerThread, &QThread::finished, this->indexer, &QObject::deleteLater);
+	this->indexerThread.start(QThread::IdlePriority);
+}
+
+ContentSearchProvider::~ContentSearchProvider()
+{
+	this->indexerToken.cancel();
+	this->indexerThread.quit();
+	this->indexerThread.wait();
+}
+
+QString ContentSearchProvider::name() const
+{
+	return "content";
+}
+
+int ContentSearchProvider::latencyBudget() const
+{
+	return 300;
+}
+
+bool ContentSearchProvider::handles(const QString &query) const
+{
+	return query.length() >= 2 && query[0] == '?';
+}
+
+void ContentSearchProvider::search(const QString &query, const CancellationToken &token,
+								   const SearchResultCallback &emitResults)
+{
+	QVector<ContentIndex::Match> matches = this->index->search(query.mid(1), MAX_RESULTS, token);
+	if(matches.isEmpty() || token.isCancelled())
+	{
+		return;
+	}
+	QMimeDatabase mimeDatabase;
+	QVector<EntryConfig> entries;
+	QVector<int> scores;
+	for(int i = 0; i < matches.size(); i++)
+	{
+		const QString &path = matches[i].path;
+		EntryConfig e;
+		e.name = path.mid(path.lastIndexOf('/') + 1);
+		e.command = "xdg-open";
+		e.arguments = QStringList{path};
+		e.iconPath = mimeDatabase.mimeTypeForFile(path, QMimeDatabase::MatchExtension).iconName();
+		e.type = EntryType::DYNAMIC;
+		/* already ranked by relevance */
+		scores.append(i);
+		entries.append(e);
+	}
+	emitResults(detachedResults(entries, scores));
+}
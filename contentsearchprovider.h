@@ -0,0 +1,30 @@
+#ifndef CONTENTSEARCHPROVIDER_H
+#define CONTENTSEARCHPROVIDER_H
+#include <QSharedPointer>
+#include <QThread>
+#include "contentindex.h"
+#include "contentindexer.h"
+#include "searchprovider.h"
+
+/* Full-text search in documents below the configured roots, for queries starting with '?' */
+class ContentSearchProvider : public SearchProvider
+{
+  private:
+	QSharedPointer<ContentIndex> index;
+	CancellationToken indexerToken;
+	QThread indexerThread;
+	ContentIndexer *indexer = nullptr;
+
+  public:
+	static const int MAX_RESULTS = 50;
+
+	ContentSearchProvider(QStringList roots, QStringList extensions, QString indexFilePath);
+	~ContentSearchProvider();
+	QString name() const override;
+	int latencyBudget() const override;
+	bool handles(const QString &query) const override;
+	void search(const QString &query, const CancellationToken &token,
+				const SearchResultCallback &emitResults) override;
+};
+
+#endif // CONTENTSEARCHPROVIDER_H
@@ -0,0 +1,144 @@
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <algorithm>
+#include "directorylister.h"
+
+DirectoryLister::DirectoryLister(QObject *parent) : QObject(parent)
+{
+	this->receiver->lister = this;
+}
+
+DirectoryLister::~DirectoryLister()
+{
+	QMutexLocker locker(&this->receiver->mutex);
+	this->receiver->lister = nullptr;
+}
+
+DirectoryLister::Listing DirectoryLister::read(const QString &directory, const Listing &previous)
+{
+	Listing result;
+	QFileInfo info(directory);
+	result.mtime = info.lastModified().toMSecsSinceEpoch();
+	if(previous.mtime >= 0 && previous.mtime == result.mtime)
+	{
+		result.entries = previous.entries;
+		return result;
+	}
+	const QFileInfoList infos =
+		QDir(directory).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+	result.entries.reserve(infos.size());
+	for(const QFileInfo &entry : infos)
+	{
+		result.entries.append({entry.fileName(), entry.isDir(), entry.isFile() && entry.isExecutable()});
+	}
+	return result;
+}
+
+bool DirectoryLister::isFresh(const QString &directory) const
+{
+	auto it = this->cache.constFind(directory);
+	return it != this->cache.constEnd() && !it->expiry.hasExpired();
+}
+
+void DirectoryLister::list(const QStringList &directories, Callback callback)
+{
+	Request request;
+	request.directories = directories;
+	request.callback = callback;
+	for(const QString &directory : directories)
+	{
+		if(isFresh(directory))
+		{
+			request.listed[directory] = this->cache[directory].entries;
+			continue;
+		}
+		if(this->pending.contains(directory))
+		{
+			continue;
+		}
+		this->pending.insert(directory);
+		Listing previous = this->cache.value(directory);
+		QSharedPointer<Receiver> receiver = this->receiver;
+		TaskScheduler::instance().scheduleBlocking([receiver, directory, previous] {
+			Listing listing = read(directory, previous);
+			QMutexLocker locker(&receiver->mutex);
+			if(DirectoryLister *lister = receiver->lister)
+			{
+				QMetaObject::invokeMethod(
+					lister, [lister, directory, listing] { lister->handleListed(directory, listing); },
+					Qt::QueuedConnection);
+			}
+		});
+	}
+	this->requests.append(request);
+	serveRequests();
+}
+
+void DirectoryLister::handleListed(const QString &directory, const Listing &listing)
+{
+	this->pending.remove(directory);
+	for(Request &request : this->requests)
+	{
+		if(request.directories.contains(directory))
+		{
+			request.listed[directory] = listing.entries;
+		}
+	}
+	Listing &cached = this->cache[directory];
+	cached = listing;
+	cached.expiry.setRemainingTime(CACHE_TTL_MSECS);
+	if(this->cache.size() > MAX_CACHED_DIRECTORIES)
+	{
+		auto oldest = this->cache.begin();
+		for(auto it = this->cache.begin(); it != this->cache.end(); ++it)
+		{
+			if(it->expiry < oldest->expiry)
+			{
+				oldest = it;
+			}
+		}
+		this->cache.erase(oldest);
+	}
+	serveRequests();
+}
+
+void DirectoryLister::serveRequests()
+{
+	for(int i = 0; i < this->requests.size();)
+	{
+		const Request &request = this->requests[i];
+		bool complete =
+			std::all_of(request.directories.begin(), request.directories.end(),
+						[&request](const QString &directory) { return request.listed.contains(directory); });
+		if(!complete)
+		{
+			i++;
+			continue;
+		}
+		QVector<Entry> entries;
+		for(const QString &directory : request.directories)
+		{
+			entries.append(request.listed.value(directory));
+		}
+		Callback callback = request.callback;
+		this->requests.removeAt(i);
+		callback(entries);
+	}
+}
+
+void DirectoryLister::clearCache()
+{
+	this->cache.clear();
+	this->cache.squeeze();
+}
+
+QJsonObject DirectoryLister::memoryReport() const
+{
+	int entries = 0;
+	for(const Listing &listing : this->cache)
+	{
+		entries += listing.entries.size();
+	}
+	return {{"directories", this->cache.size()}, {"entries", entries}};
+}
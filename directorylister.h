@@ -0,0 +1,79 @@
+#ifndef DIRECTORYLISTER_H
+#define DIRECTORYLISTER_H
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include "taskscheduler.h"
+
+/* Lists directories in the TaskScheduler's blocking lane, so slow (e. g. network) directories
+ * can't block the GUI, nor the workers searching.
+ *
+ * Recent listings are cached. Within CACHE_TTL_MSECS they are served as they are, afterwards
+ * they are revalidated against the directory's mtime before they are read again. */
+class DirectoryLister : public QObject
+{
+	Q_OBJECT
+  public:
+	struct Entry
+	{
+		QString name;
+		bool isDir;
+		bool isExecutable;
+	};
+	typedef std::function<void(const QVector<Entry> &)> Callback;
+
+	static const int CACHE_TTL_MSECS = 5000;
+	static const int MAX_CACHED_DIRECTORIES = 64;
+
+  private:
+	struct Listing
+	{
+		QVector<Entry> entries;
+		qint64 mtime = -1;
+		QDeadlineTimer expiry;
+	};
+	struct Request
+	{
+		QStringList directories;
+		/* Copied as they come in, the cache may evict them before the others are there */
+		QHash<QString, QVector<Entry>> listed;
+		Callback callback;
+	};
+
+	/* Where listings report back to. Listings stuck on a hung mount are not waited for, the
+	 * lister just goes away, so they find nobody to report to when they finally return */
+	struct Receiver
+	{
+		QMutex mutex;
+		DirectoryLister *lister = nullptr;
+	};
+
+	QHash<QString, Listing> cache;
+	QSet<QString> pending;
+	QVector<Request> requests;
+	QSharedPointer<Receiver> receiver{new Receiver()};
+
+	static Listing read(const QString &directory, const Listing &previous);
+	bool isFresh(const QString &directory) const;
+	void handleListed(const QString &directory, const Listing &listing);
+	void serveRequests();
+
+  public:
+	explicit DirectoryLister(QObject *parent = nullptr);
+	~DirectoryLister();
+	/* Calls callback (in this thread) with the entries of all directories, right away when all of
+	 * them are cached. Directories that can't be read are treated as empty */
+	void list(const QStringList &directories, Callback callback);
+	void clearCache();
+	/* Number of cached listings and their entries */
+	QJsonObject memoryReport() const;
+};
+
+#endif // DIRECTORYLISTER_H
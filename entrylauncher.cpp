@@ -0,0 +1,18 @@
+#include <QProcess>
+#include "entrylauncher.h"
+
+bool launchEntry(const EntryConfig &config, const QString &terminalCommand, bool forceTerminal)
+{
+	if(config.isTerminalCommand || forceTerminal)
+	{
+		QString cmd = terminalCommand;
+		cmd.replace("%c", config.command);
+		QStringList args = QProcess::splitCommand(cmd);
+		if(args.isEmpty())
+		{
+			return false;
+		}
+		return QProcess::startDetached(args[0], args);
+	}
+	return QProcess::startDetached(config.command, config.arguments);
+}
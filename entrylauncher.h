@@ -0,0 +1,9 @@
+#ifndef ENTRYLAUNCHER_H
+#define ENTRYLAUNCHER_H
+#include "entryprovider.h"
+
+/* Starts the entry detached. Terminal commands, or all if forceTerminal is set, are run using terminalCommand,
+ * where %c is replaced by the command */
+bool launchEntry(const EntryConfig &config, const QString &terminalCommand, bool forceTerminal = false);
+
+#endif // ENTRYLAUNCHER_H
@@ -2,6 +2,7 @@
 #include <QDebug>
 #include <QDirIterator>
 #include <QTextStream>
+#include <unistd.h>
 
 EntryProvider::EntryProvider(QStringList userEntriesDirsPaths, QStringList systemEntriesDirsPaths)
 {
@@ -13,6 +14,12 @@ EntryProvider::EntryProvider(QStringList userEntriesDirsPaths, QStringList syste
 					   << "%u";
 }
 
+void EntryProvider::setEntriesDirsPaths(QStringList userEntriesDirsPaths, QStringList systemEntriesDirsPaths)
+{
+	this->userEntriesDirsPaths = userEntriesDirsPaths;
+	this->systemEntriesDirsPaths = systemEntriesDirsPaths;
+}
+
 bool EntryProvider::isSavable(const EntryConfig &config) const
 {
 	return ! config.entryPath.isEmpty() && (config.type == EntryType::USER || config.type == EntryType::INHERIT);
@@ -290,19 +297,14 @@ QVector<EntryConfig> EntryProvider::getSystemEntries()
 	return readConfig(this->systemEntriesDirsPaths);
 }
 
-void EntryProvider::saveUserEntry(const EntryConfig &config)
+QByteArray EntryProvider::serializeUserEntry(const EntryConfig &config) const
 {
 	if(!isSavable(config))
 	{
 		throw std::runtime_error("Only user/inherited entries can be saved");
 	}
-	QString transitPath = config.entryPath + ".transit";
-	QFile file{transitPath};
-	if(!file.open(QIODevice::WriteOnly))
-	{
-		throw std::runtime_error("Error: Can not open file for writing");
-	}
-	QTextStream outStream(&file);
+	QByteArray result;
+	QTextStream outStream(&result);
 	outStream << "type" << " " << ((config.type == EntryType::USER) ? "user" : "inherit") << Qt::endl;
 	if(!config.inherit.isEmpty())
 	{
@@ -334,8 +336,23 @@ void EntryProvider::saveUserEntry(const EntryConfig &config)
 			outStream << "arguments" << " " << config.arguments.join(' ') << Qt::endl;
 		}
 	}
-
 	outStream.flush();
+	return result;
+}
+
+void EntryProvider::saveUserEntry(const EntryConfig &config)
+{
+	QByteArray content = serializeUserEntry(config);
+	QString transitPath = config.entryPath + ".transit";
+	QFile file{transitPath};
+	if(!file.open(QIODevice::WriteOnly))
+	{
+		throw std::runtime_error("Error: Can not open file for writing");
+	}
+	if(file.write(content) != content.size() || !file.flush() || fsync(file.handle()) != 0)
+	{
+		throw std::runtime_error("Error: Failed to write entry file");
+	}
 	file.close();
 
 	// Qts don't work if file already exists and c++17... don't want to pull in the fs lib yet
@@ -36,6 +36,8 @@ class EntryConfig
 	QString iconPath;
 	QStringList arguments;
 	QString inherit;
+	/* The command line as it was typed, for ad-hoc commands that are kept in the history */
+	QString commandLine;
 	int row = 0;
 	int col = 0;
 
@@ -56,9 +58,11 @@ class EntryProvider
 
   public:
 	EntryProvider(QStringList userEntriesDirsPaths, QStringList systemEntriesDirsPaths);
+	void setEntriesDirsPaths(QStringList userEntriesDirsPaths, QStringList systemEntriesDirsPaths);
 	bool isSavable(const EntryConfig &config) const;
 	QVector<EntryConfig> getUserEntries();
 	QVector<EntryConfig> getSystemEntries();
+	QByteArray serializeUserEntry(const EntryConfig &config) const;
 	void saveUserEntry(const EntryConfig &config);
 	bool deleteUserEntry(const EntryConfig &config);
 };
@@ -18,68 +18,155 @@
 #include <QMimeData>
 #include <QApplication>
 #include "entrypushbutton.h"
+#include "iconthemeindex.h"
+#include "memoryaccounting.h"
+#include "pixmapcache.h"
+#include "stallwatchdog.h"
 
-EntryPushButton::EntryPushButton(const EntryConfig &config) : QPushButton()
+int EntryPushButton::instances = 0;
+int EntryPushButton::resolvedIcons = 0;
+
+EntryPushButton::EntryPushButton(EntryStorePtr store, int index) : QPushButton()
 {
-	this->setText(config.name);
+	++instances;
 	this->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-	QIcon icon;
-	if(config.isTerminalCommand && config.iconPath.isEmpty())
+	this->setIconSize(QSize{ICON_SIZE, ICON_SIZE});
+	bind(store, index);
+	connect(this, SIGNAL(clicked()), this, SLOT(emitOwnClicked()));
+}
+
+EntryPushButton::~EntryPushButton()
+{
+	--instances;
+	if(this->iconResolved)
 	{
-		icon = resolveIcon("utilities-terminal");
+		--resolvedIcons;
 	}
-	else
+}
+
+int EntryPushButton::instanceCount()
+{
+	return instances;
+}
+
+int EntryPushButton::resolvedIconCount()
+{
+	return resolvedIcons;
+}
+
+void EntryPushButton::bind(EntryStorePtr store, int index)
+{
+	PhaseScope phase("loading icon");
+	this->store = store;
+	this->index = index;
+	const EntryConfig &config = entry();
+	this->row = config.row;
+	this->col = config.col;
+	this->shortcutKey = config.key;
+	this->setText(config.name);
+	QString iconName = config.iconPath;
+	if(config.isTerminalCommand && iconName.isEmpty())
 	{
-		icon = resolveIcon(config.iconPath);
+		iconName = "utilities-terminal";
 	}
-	this->setIcon(icon);
-	this->setIconSize(QSize{256, 256});
-	this->config = config;
-	connect(this, SIGNAL(clicked()), this, SLOT(emitOwnClicked()));
+	/* Recycled buttons mostly show the same icon again */
+	if(iconName != this->iconName)
+	{
+		this->iconName = iconName;
+		if(this->iconResolved)
+		{
+			this->iconResolved = false;
+			--resolvedIcons;
+		}
+	}
+	ensureIcon();
+}
 
-	systemEntryMenu.addAction("Add to favorites", [&] { emit addToFavourites(this->config); });
-	userEntryMenu.addAction("Delete", [&] { emit deleteRequested(this->config); });
+void EntryPushButton::rebind(EntryStorePtr store, int index)
+{
+	this->store = store;
+	this->index = index;
+}
+
+void EntryPushButton::ensureIcon()
+{
+	if(!this->iconResolved)
+	{
+		this->setIcon(resolveIcon(this->iconName));
+		this->iconResolved = true;
+		++resolvedIcons;
+	}
+}
+
+void EntryPushButton::releaseIcon()
+{
+	if(this->iconResolved)
+	{
+		this->setIcon(QIcon());
+		this->iconResolved = false;
+		--resolvedIcons;
+	}
+}
+
+const EntryConfig &EntryPushButton::entry() const
+{
+	return this->store->at(this->index);
 }
 
 QIcon EntryPushButton::resolveIcon(QString path)
 {
+	AllocationScope allocations(MemoryAccounting::ICONS);
 	if(!path.isEmpty())
 	{
-		if(path[0] == '/')
+		QString sourcePath = path[0] == '/' ? path : IconThemeIndex::instance().iconFile(path, ICON_SIZE);
+		if(sourcePath.isEmpty())
 		{
-			return QIcon(path);
+			/* Not in the index (e.g. from a Qt resource theme), or the index is still being built:
+			 * let Qt search for it */
+			return QIcon::fromTheme(path);
 		}
-		else
+		QPixmap pixmap = PixmapCache::instance().pixmap(sourcePath, ICON_SIZE, qApp->devicePixelRatio());
+		if(pixmap.isNull())
 		{
-			return QIcon::fromTheme(path);
+			return QIcon(sourcePath);
 		}
+		return QIcon(pixmap);
 	}
 	return QIcon();
 }
 
 void EntryPushButton::emitOwnClicked()
 {
-	emit clicked(this->config);
+	emit clicked(getEntryConfig());
 }
 
-const EntryConfig &EntryPushButton::getEntryConfig() const
+EntryConfig EntryPushButton::getEntryConfig() const
 {
-	return this->config;
+	EntryConfig result = entry();
+	result.row = this->row;
+	result.col = this->col;
+	result.key = this->shortcutKey;
+	return result;
 }
 
-void EntryPushButton::setEntryConfig(const EntryConfig &config)
+const EntryConfig &EntryPushButton::getStoredEntryConfig() const
 {
-	this->config = config;
+	return entry();
+}
+
+QString EntryPushButton::getEntryPath() const
+{
+	return entry().entryPath;
 }
 
 void EntryPushButton::showShortcut()
 {
-	this->setText(this->config.key);
+	this->setText(this->shortcutKey);
 }
 
 void EntryPushButton::showName()
 {
-	this->setText(this->config.name);
+	this->setText(entry().name);
 }
 
 void EntryPushButton::mousePressEvent(QMouseEvent *event)
@@ -90,13 +177,23 @@ void EntryPushButton::mousePressEvent(QMouseEvent *event)
 	}
 	if(event->button() == Qt::RightButton)
 	{
-		if(this->config.type == EntryType::USER || this->config.type == EntryType::INHERIT)
+		/* Menus are rarely needed, so they are only created when requested */
+		EntryType type = entry().type;
+		QMenu menu;
+		if(type == EntryType::USER || type == EntryType::INHERIT)
+		{
+			menu.addAction("Delete", [&] {
+				EntryConfig config = getEntryConfig();
+				emit deleteRequested(config);
+			});
+		}
+		else if(type == EntryType::SYSTEM)
 		{
-			this->userEntryMenu.exec(QCursor::pos());
+			menu.addAction("Add to favorites", [&] { emit addToFavourites(getEntryConfig()); });
 		}
-		else if(this->config.type == EntryType::SYSTEM)
+		if(!menu.isEmpty())
 		{
-			this->systemEntryMenu.exec(QCursor::pos());
+			menu.exec(QCursor::pos());
 		}
 	}
 	return QPushButton::mousePressEvent(event);
@@ -104,7 +201,7 @@ void EntryPushButton::mousePressEvent(QMouseEvent *event)
 
 void EntryPushButton::mouseMoveEvent(QMouseEvent *event)
 {
-	if(this->config.type == EntryType::SYSTEM || this->config.type == EntryType::DYNAMIC)
+	if(entry().type == EntryType::SYSTEM || entry().type == EntryType::DYNAMIC)
 	{
 		return;
 	}
@@ -127,37 +224,41 @@ void EntryPushButton::mouseMoveEvent(QMouseEvent *event)
 
 int EntryPushButton::getRow() const
 {
-	return config.row;
+	return this->row;
 }
 int EntryPushButton::getCol() const
 {
-	return config.col;
+	return this->col;
 }
 QString EntryPushButton::getName() const
 {
-	return config.name;
+	return entry().name;
+}
+EntryType EntryPushButton::getType() const
+{
+	return entry().type;
 }
 QString EntryPushButton::getShortcutKey() const
 {
-	return config.key;
+	return this->shortcutKey;
 }
 void EntryPushButton::setShortcutKey(QString key)
 {
-	this->config.key = key;
+	this->shortcutKey = key;
 }
 void EntryPushButton::setRow(int row)
 {
-	this->config.row = row;
+	this->row = row;
 }
 void EntryPushButton::setCol(int col)
 {
-	this->config.col = col;
+	this->col = col;
 }
 QStringList EntryPushButton::getArguments() const
 {
-	return this->config.arguments;
+	return entry().arguments;
 }
 QString EntryPushButton::getCommand() const
 {
-	return this->config.command;
+	return entry().command;
 }
@@ -22,6 +22,7 @@
 #include <QMenu>
 
 #include "entryprovider.h"
+#include "entrystore.h"
 
 #define ENTRYBUTTON_MIME_TYPE_STR "application/x-qsrun-entrypushbutton"
 
@@ -29,10 +30,22 @@ class EntryPushButton : public QPushButton
 {
 	Q_OBJECT
   private:
-	QMenu systemEntryMenu;
-	QMenu userEntryMenu;
-	EntryConfig config;
+	EntryStorePtr store;
+	int index = 0;
+	/* Per button state that may differ from the stored entry */
+	int row = 0;
+	int col = 0;
+	QString shortcutKey;
+	/* What the current icon was resolved from */
+	QString iconName;
+	bool iconResolved = false;
 	QPoint dragStartPosition;
+	static const int ICON_SIZE = 256;
+	/* Alive buttons and how many of them hold a decoded icon, for /memory */
+	static int instances;
+	static int resolvedIcons;
+
+	const EntryConfig &entry() const;
 
   private slots:
 	void emitOwnClicked();
@@ -48,14 +61,27 @@ class EntryPushButton : public QPushButton
 	QIcon resolveIcon(QString path);
 
   public:
-	EntryPushButton(const EntryConfig &config);
-	const EntryConfig &getEntryConfig() const;
-	void setEntryConfig(const EntryConfig &config);
+	EntryPushButton(EntryStorePtr store, int index);
+	~EntryPushButton();
+	static int instanceCount();
+	static int resolvedIconCount();
+	/* The stored entry with this button's position and shortcut applied */
+	EntryConfig getEntryConfig() const;
+	/* The entry as it is in the store, without this button's changes */
+	const EntryConfig &getStoredEntryConfig() const;
+	QString getEntryPath() const;
+	void bind(EntryStorePtr store, int index);
+	/* Points the button to the same entry in a new store, without updating anything else */
+	void rebind(EntryStorePtr store, int index);
+	/* Frees the decoded icon, it is resolved again by ensureIcon() before the button is shown */
+	void releaseIcon();
+	void ensureIcon();
 	void showShortcut();
 	void showName();
 	int getRow() const;
 	int getCol() const;
 	QString getName() const;
+	EntryType getType() const;
 	QString getShortcutKey() const;
 	QStringList getArguments() const;
 	QString getCommand() const;
@@ -0,0 +1,463 @@
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <vector>
+#include "entrysearchprovider.h"
+#include "metrics.h"
+
+/* System entries always rank below matching user entries, but are still listed when some of those match */
+static const int SYSTEM_ENTRY_SCORE_OFFSET = 10;
+
+/* Returns the k best candidates in order. Uses a bounded max-heap, so O(n log k) instead of sorting everything.
+ * The selected ones are removed from candidates */
+static QVector<SearchResult> takeTopRanked(QVector<SearchResult> &candidates, int k)
+{
+	std::priority_queue<int, std::vector<int>, std::function<bool(int, int)>> heap(
+		[&candidates](int a, int b) { return candidates[a] < candidates[b]; });
+	for(int i = 0; i < candidates.size(); i++)
+	{
+		if(static_cast<int>(heap.size()) < k)
+		{
+			heap.push(i);
+		}
+		else if(candidates[i] < candidates[heap.top()])
+		{
+			heap.pop();
+			heap.push(i);
+		}
+	}
+	QVector<SearchResult> result(static_cast<int>(heap.size()));
+	QVector<bool> taken(candidates.size(), false);
+	for(int i = result.size() - 1; i >= 0; i--)
+	{
+		result[i] = candidates[heap.top()];
+		taken[heap.top()] = true;
+		heap.pop();
+	}
+	int remaining = 0;
+	for(int i = 0; i < candidates.size(); i++)
+	{
+		if(!taken[i])
+		{
+			candidates[remaining++] = candidates[i];
+		}
+	}
+	candidates.resize(remaining);
+	return result;
+}
+
+/* Keeps the k best of the results added to it in a bounded max-heap, the others are collected
+ * in rest as they come */
+class TopRanked
+{
+  private:
+	int k;
+	std::priority_queue<SearchResult> heap;
+
+  public:
+	QVector<SearchResult> rest;
+
+	explicit TopRanked(int k) : k(k)
+	{
+	}
+
+	void add(const SearchResult &result)
+	{
+		if(static_cast<int>(this->heap.size()) < this->k)
+		{
+			this->heap.push(result);
+		}
+		else if(result < this->heap.top())
+		{
+			this->rest.append(this->heap.top());
+			this->heap.pop();
+			this->heap.push(result);
+		}
+		else
+		{
+			this->rest.append(result);
+		}
+	}
+
+	/* The best ones in order */
+	QVector<SearchResult> takeBest()
+	{
+		QVector<SearchResult> result(static_cast<int>(this->heap.size()));
+		for(int i = result.size() - 1; i >= 0; i--)
+		{
+			result[i] = this->heap.top();
+			this->heap.pop();
+		}
+		return result;
+	}
+};
+
+/* A match split into chunks, shared with the workers helping with it. Workers take the next chunk
+ * until none are left, so a helper that only starts late simply finds nothing to do */
+struct PartitionedMatch
+{
+	EntryStorePtr store;
+	QString query;
+	QVector<int> candidates;
+	bool narrowed = false;
+	CancellationToken token;
+	int count = 0;
+	int chunkCount = 0;
+	std::atomic<int> nextChunk{0};
+	std::atomic<int> nextParticipant{0};
+	/* Per participant: its best matches in order, and all its other ones */
+	std::vector<QVector<SearchResult>> best;
+	std::vector<QVector<SearchResult>> rest;
+	QMutex mutex;
+	QWaitCondition done;
+	int finishedChunks = 0;
+};
+
+int EntrySearchProvider::rankConfig(const EntryConfig &config, const QString &filter)
+{
+	if(config.name.startsWith(filter, Qt::CaseInsensitive))
+	{
+		return 0;
+	}
+	else if(config.command.startsWith(filter, Qt::CaseInsensitive))
+	{
+		return 1;
+	}
+	else if(config.name.contains(filter, Qt::CaseInsensitive))
+	{
+		return 2;
+	}
+	else if(config.command.contains(filter, Qt::CaseInsensitive))
+	{
+		return 3;
+	}
+	return -1;
+}
+
+void EntrySearchProvider::setEntries(EntryStorePtr store)
+{
+	QMutexLocker locker(&this->mutex);
+	this->store = store;
+	++this->generation;
+	this->cache.clear();
+}
+
+/* Matches the entries [begin, end) of store, or of candidates if given. Candidates are the store indexes
+ * of the results of a prefix of query: whatever matches query also matches its prefixes */
+QVector<SearchResult> EntrySearchProvider::match(const EntryStorePtr &store, const QString &query,
+												 const QVector<int> *candidates, int begin, int end,
+												 const CancellationToken &token)
+{
+	QVector<SearchResult> matches;
+	for(int i = begin; i < end; i++)
+	{
+		if(i % 1024 == 0 && token.isCancelled())
+		{
+			return {};
+		}
+		const int index = candidates != nullptr ? candidates->at(i) : i;
+		int ranking = rankConfig(store->at(index), query);
+		if(ranking > -1)
+		{
+			SearchResult result;
+			result.store = store;
+			result.index = index;
+			result.score = (store->isUserEntry(index) ? 0 : SYSTEM_ENTRY_SCORE_OFFSET) + ranking;
+			matches.append(result);
+		}
+	}
+	return matches;
+}
+
+/* Matches like match(), but chunk by chunk on up to threads workers (0: all of them), the calling
+ * thread included. Each of them keeps its own FIRST_BATCH_SIZE best matches, which are merged into
+ * best, in order. All other matches end up in rest, in no particular order */
+void EntrySearchProvider::matchPartitioned(const EntryStorePtr &store, const QString &query,
+										   const QVector<int> *candidates, int threads,
+										   const CancellationToken &token, QVector<SearchResult> &best,
+										   QVector<SearchResult> &rest)
+{
+	QSharedPointer<PartitionedMatch> state(new PartitionedMatch());
+	state->store = store;
+	state->query = query;
+	if(candidates != nullptr)
+	{
+		state->candidates = *candidates;
+		state->narrowed = true;
+	}
+	state->token = token;
+	state->count = candidates != nullptr ? candidates->size() : store->size();
+	state->chunkCount = (state->count + MATCH_CHUNK_SIZE - 1) / MATCH_CHUNK_SIZE;
+	if(state->chunkCount == 0)
+	{
+		return;
+	}
+	TaskScheduler &scheduler = TaskScheduler::instance();
+	const int participants = std::min(threads > 0 ? threads : scheduler.workerCount(), state->chunkCount);
+	state->best.resize(participants);
+	state->rest.resize(participants);
+
+	auto work = [](PartitionedMatch &state) {
+		int chunk = state.nextChunk++;
+		if(chunk >= state.chunkCount)
+		{
+			return;
+		}
+		const int participant = state.nextParticipant++;
+		TopRanked top(FIRST_BATCH_SIZE);
+		int finished = 0;
+		for(; chunk < state.chunkCount; chunk = state.nextChunk++)
+		{
+			int begin = chunk * MATCH_CHUNK_SIZE;
+			int end = std::min(begin + MATCH_CHUNK_SIZE, state.count);
+			const QVector<SearchResult> matches =
+				match(state.store, state.query, state.narrowed ? &state.candidates : nullptr, begin, end, state.token);
+			for(const SearchResult &result : matches)
+			{
+				top.add(result);
+			}
+			finished++;
+		}
+		QMutexLocker locker(&state.mutex);
+		state.best[participant] = top.takeBest();
+		state.rest[participant] = std::move(top.rest);
+		state.finishedChunks += finished;
+		if(state.finishedChunks == state.chunkCount)
+		{
+			state.done.wakeAll();
+		}
+	};
+	for(int i = 1; i < participants; i++)
+	{
+		scheduler.schedule(
+			TaskScheduler::INTERACTIVE, [state, work] { work(*state); }, token);
+	}
+	work(*state);
+
+	/* Wait for the chunks the helpers are still busy with, not for the helpers themselves.
+	 * A participant hands in its matches together with the count of its chunks */
+	QMutexLocker locker(&state->mutex);
+	while(state->finishedChunks < state->chunkCount)
+	{
+		state->done.wait(&state->mutex);
+	}
+	QVector<SearchResult> candidatesForBest;
+	for(int i = 0; i < participants; i++)
+	{
+		candidatesForBest.append(state->best[i]);
+		rest.append(state->rest[i]);
+	}
+	best = takeTopRanked(candidatesForBest, FIRST_BATCH_SIZE);
+	rest.append(candidatesForBest);
+}
+
+QVector<SearchResult> EntrySearchProvider::rankAll(const EntryStorePtr &store, const QString &query, int threads)
+{
+	QVector<SearchResult> best;
+	QVector<SearchResult> rest;
+	matchPartitioned(store, query, nullptr, threads, {}, best, rest);
+	return best + rest;
+}
+
+void EntrySearchProvider::cacheResults(quint64 generation, const QString &key, const QVector<SearchResult> &best,
+									   const QVector<SearchResult> &rest)
+{
+	if(best.size() + rest.size() > MAX_CACHED_IDS_PER_QUERY)
+	{
+		return;
+	}
+	QVector<int> *cached = new QVector<int>();
+	cached->reserve(best.size() + rest.size());
+	for(const SearchResult &result : best)
+	{
+		cached->append(result.index);
+	}
+	for(const SearchResult &result : rest)
+	{
+		cached->append(result.index);
+	}
+	QMutexLocker locker(&this->mutex);
+	if(generation != this->generation)
+	{
+		delete cached;
+		return;
+	}
+	this->cache.insert(key, cached, std::max(1, cached->size()));
+}
+
+void EntrySearchProvider::prefillCache()
+{
+	QStringList queries;
+	{
+		QMutexLocker locker(&this->mutex);
+		QVector<QPair<int, QString>> counted;
+		for(auto it = this->shortQueryCounts.begin(); it != this->shortQueryCounts.end(); ++it)
+		{
+			counted.append({it.value(), it.key()});
+		}
+		std::sort(counted.begin(), counted.end(), [](const QPair<int, QString> &a, const QPair<int, QString> &b) {
+			return a.first > b.first;
+		});
+		for(int i = 0; i < counted.size() && i < PREFILL_QUERIES; i++)
+		{
+			queries.append(counted[i].second);
+		}
+	}
+	/* Nothing typed yet, single letters are what is typed first anyway */
+	for(char c = 'a'; c <= 'z' && queries.size() < PREFILL_QUERIES; c++)
+	{
+		if(!queries.contains(QString(c)))
+		{
+			queries.append(QString(c));
+		}
+	}
+	TaskScheduler::instance().schedule(
+		TaskScheduler::MAINTENANCE,
+		[this, queries] {
+			for(const QString &query : queries)
+			{
+				EntryStorePtr store;
+				quint64 generation;
+				{
+					QMutexLocker locker(&this->mutex);
+					if(this->cache.contains(query))
+					{
+						continue;
+					}
+					store = this->store;
+					generation = this->generation;
+				}
+				if(store.isNull())
+				{
+					return;
+				}
+				QVector<SearchResult> results = match(store, query, nullptr, 0, store->size(), {});
+				/* Would not be cached anyway, see MAX_CACHED_IDS_PER_QUERY */
+				if(results.size() > MAX_CACHED_IDS_PER_QUERY)
+				{
+					continue;
+				}
+				QVector<SearchResult> best = takeTopRanked(results, FIRST_BATCH_SIZE);
+				cacheResults(generation, query, best, results);
+			}
+		},
+		{}, &this->tasks);
+}
+
+QJsonObject EntrySearchProvider::memoryReport() const
+{
+	QMutexLocker locker(&this->mutex);
+	return {{"cached_queries", this->cache.count()},
+			{"cached_ids", this->cache.totalCost()},
+			{"result_bytes", static_cast<qint64>(this->cache.totalCost() * sizeof(int))},
+			{"short_queries", this->shortQueryCounts.size()}};
+}
+
+QString EntrySearchProvider::name() const
+{
+	return "entries";
+}
+
+int EntrySearchProvider::latencyBudget() const
+{
+	return 200;
+}
+
+void EntrySearchProvider::search(const QString &query, const CancellationToken &token,
+								 const SearchResultCallback &emitResults)
+{
+	const QString key = query.toCaseFolded();
+	EntryStorePtr store;
+	quint64 generation;
+	QVector<int> cached;
+	QVector<int> candidates;
+	bool hit = false;
+	bool narrowed = false;
+	{
+		QMutexLocker locker(&this->mutex);
+		store = this->store;
+		generation = this->generation;
+		if(key.size() <= MAX_SHORT_QUERY_LENGTH)
+		{
+			++this->shortQueryCounts[key];
+		}
+		if(QVector<int> *results = this->cache.object(key))
+		{
+			cached = *results;
+			hit = true;
+		}
+		else
+		{
+			/* The results of the longest cached prefix are all there is to look at */
+			for(int length = key.size() - 1; length > 0 && !narrowed; length--)
+			{
+				if(QVector<int> *results = this->cache.object(key.left(length)))
+				{
+					candidates = *results;
+					narrowed = true;
+				}
+			}
+		}
+	}
+	if(store.isNull())
+	{
+		return;
+	}
+	Metrics &metrics = Metrics::instance();
+	metrics.add(hit ? "querycache.hits" : "querycache.misses");
+	if(narrowed)
+	{
+		metrics.add("querycache.prefix_hits");
+	}
+	qint64 hits = metrics.value("querycache.hits");
+	metrics.set("querycache.hit_rate_percent", hits * 100 / (hits + metrics.value("querycache.misses")));
+	if(hit)
+	{
+		QVector<SearchResult> results = match(store, query, &cached, 0, cached.size(), token);
+		if(!results.isEmpty())
+		{
+			emitResults(results);
+		}
+		return;
+	}
+
+	const QVector<int> *from = narrowed ? &candidates : nullptr;
+	const int count = narrowed ? candidates.size() : store->size();
+	QVector<SearchResult> firstBatch;
+	QVector<SearchResult> matches;
+	if(count >= PARALLEL_MATCH_THRESHOLD && TaskScheduler::instance().workerCount() > 1)
+	{
+		metrics.add("entries.partitioned_matches");
+		matchPartitioned(store, query, from, 0, token, firstBatch, matches);
+		if(token.isCancelled())
+		{
+			return;
+		}
+		if(!firstBatch.isEmpty())
+		{
+			emitResults(firstBatch);
+		}
+	}
+	else
+	{
+		matches = match(store, query, from, 0, count, token);
+
+		/* The first screen only needs the best few. The rest is ordered by whoever pages through it */
+		firstBatch = takeTopRanked(matches, FIRST_BATCH_SIZE);
+		if(!firstBatch.isEmpty())
+		{
+			emitResults(firstBatch);
+		}
+		if(token.isCancelled())
+		{
+			return;
+		}
+	}
+	if(!matches.isEmpty())
+	{
+		emitResults(matches);
+	}
+	cacheResults(generation, key, firstBatch, matches);
+}
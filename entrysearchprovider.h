@@ -0,0 +1,65 @@
+#ifndef ENTRYSEARCHPROVIDER_H
+#define ENTRYSEARCHPROVIDER_H
+#include <QCache>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include "entrystore.h"
+#include "searchprovider.h"
+#include "taskscheduler.h"
+
+/* Searches the user and system entries */
+class EntrySearchProvider : public SearchProvider
+{
+  private:
+	mutable QMutex mutex;
+	EntryStorePtr store;
+	/* Bumped with every new store, results of older ones are not cached */
+	quint64 generation = 0;
+	/* Store indexes of the results by case folded query, the FIRST_BATCH_SIZE best ones in order in
+	 * front. The cost is the number of ids */
+	QCache<QString, QVector<int>> cache{MAX_CACHED_IDS};
+	/* How often short queries were typed, to know which ones are worth prefilling */
+	QHash<QString, int> shortQueryCounts;
+	/* Declared last so that it is destroyed first, waiting for prefilling */
+	TaskGroup tasks;
+
+	static QVector<SearchResult> match(const EntryStorePtr &store, const QString &query,
+									   const QVector<int> *candidates, int begin, int end,
+									   const CancellationToken &token);
+	static void matchPartitioned(const EntryStorePtr &store, const QString &query,
+								 const QVector<int> *candidates, int threads, const CancellationToken &token,
+								 QVector<SearchResult> &best, QVector<SearchResult> &rest);
+	void cacheResults(quint64 generation, const QString &key, const QVector<SearchResult> &best,
+					  const QVector<SearchResult> &rest);
+
+  public:
+	/* Number of best results emitted in order, before the unordered rest */
+	static const int FIRST_BATCH_SIZE = 64;
+	static const int MAX_CACHED_IDS = 262144;
+	/* Longer result lists are not cached. A cut down list could neither narrow later queries nor
+	 * spare matching the whole store for the rest of the results */
+	static const int MAX_CACHED_IDS_PER_QUERY = 4096;
+	static const int MAX_SHORT_QUERY_LENGTH = 3;
+	static const int PREFILL_QUERIES = 32;
+	/* From this many candidates on, matching is spread over the workers */
+	static const int PARALLEL_MATCH_THRESHOLD = 16384;
+	/* Candidates per unit of work the workers take */
+	static const int MATCH_CHUNK_SIZE = 2048;
+	static int rankConfig(const EntryConfig &config, const QString &filter);
+	/* All matches of query in store, the FIRST_BATCH_SIZE best ones in order in front, matched by
+	 * up to threads workers (0: all of them) */
+	static QVector<SearchResult> rankAll(const EntryStorePtr &store, const QString &query, int threads);
+
+	void setEntries(EntryStorePtr store);
+	/* Size of the query cache */
+	QJsonObject memoryReport() const;
+	/* Fills the cache for the most frequent short queries in the background */
+	void prefillCache();
+	QString name() const override;
+	int latencyBudget() const override;
+	void search(const QString &query, const CancellationToken &token,
+				const SearchResultCallback &emitResults) override;
+};
+
+#endif // ENTRYSEARCHPROVIDER_H
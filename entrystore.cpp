@@ -0,0 +1,117 @@
+#include <QSet>
+#include "entrystore.h"
+#include "memoryaccounting.h"
+
+class StringPool
+{
+  private:
+	QSet<QString> strings;
+
+  public:
+	void intern(QString &str)
+	{
+		if(str.isEmpty())
+		{
+			return;
+		}
+		auto it = strings.constFind(str);
+		if(it != strings.constEnd())
+		{
+			str = *it;
+		}
+		else
+		{
+			strings.insert(str);
+		}
+	}
+};
+
+EntryStore::EntryStore(const QVector<EntryConfig> &userEntries, const QVector<EntryConfig> &systemEntries)
+{
+	this->entries.reserve(userEntries.size() + systemEntries.size());
+	this->entries.append(userEntries);
+	this->entries.append(systemEntries);
+	this->userEntryCount = userEntries.size();
+
+	StringPool pool;
+	for(EntryConfig &entry : this->entries)
+	{
+		pool.intern(entry.name);
+		pool.intern(entry.command);
+		pool.intern(entry.iconPath);
+		pool.intern(entry.inherit);
+		pool.intern(entry.key);
+		for(QString &argument : entry.arguments)
+		{
+			pool.intern(argument);
+		}
+	}
+	this->entries.squeeze();
+}
+
+QSharedPointer<const EntryStore> EntryStore::detached(const QVector<EntryConfig> &entries)
+{
+	/* One allocation for the store and its reference count. The entries are shared, not copied */
+	QSharedPointer<EntryStore> result = QSharedPointer<EntryStore>::create();
+	result->entries = entries;
+	return result;
+}
+
+const EntryConfig &EntryStore::at(int index) const
+{
+	return this->entries[index];
+}
+
+int EntryStore::size() const
+{
+	return this->entries.size();
+}
+
+int EntryStore::userCount() const
+{
+	return this->userEntryCount;
+}
+
+bool EntryStore::isUserEntry(int index) const
+{
+	return index < this->userEntryCount;
+}
+
+QVector<EntryConfig> EntryStore::userEntries() const
+{
+	return this->entries.mid(0, this->userEntryCount);
+}
+
+QVector<EntryConfig> EntryStore::systemEntries() const
+{
+	return this->entries.mid(this->userEntryCount);
+}
+
+QJsonObject EntryStore::memoryReport() const
+{
+	QSet<const void *> seen;
+	qint64 stringBytes = 0;
+	auto count = [&seen, &stringBytes](const QString &str) {
+		if(!str.isNull() && !seen.contains(str.constData()))
+		{
+			seen.insert(str.constData());
+			stringBytes += MemoryAccounting::stringBytes(str);
+		}
+	};
+	for(const EntryConfig &entry : this->entries)
+	{
+		for(const QString *str : {&entry.entryPath, &entry.key, &entry.name, &entry.command, &entry.iconPath,
+								  &entry.inherit, &entry.commandLine})
+		{
+			count(*str);
+		}
+		for(const QString &argument : entry.arguments)
+		{
+			count(argument);
+		}
+	}
+	return {{"entries", this->entries.size()},
+			{"user_entries", this->userEntryCount},
+			{"entry_bytes", static_cast<qint64>(this->entries.capacity() * sizeof(EntryConfig))},
+			{"string_bytes", stringBytes}};
+}
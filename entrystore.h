@@ -0,0 +1,35 @@
+#ifndef ENTRYSTORE_H
+#define ENTRYSTORE_H
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <QVector>
+#include "entryprovider.h"
+
+/* Immutable catalog of entries, user entries first, followed by the system entries.
+ * Equal strings (icons, commands, arguments...) share their data. Buttons and search results refer to
+ * entries by index, changes produce a new store. */
+class EntryStore
+{
+  private:
+	QVector<EntryConfig> entries;
+	int userEntryCount = 0;
+
+  public:
+	EntryStore() = default;
+	EntryStore(const QVector<EntryConfig> &userEntries, const QVector<EntryConfig> &systemEntries);
+	/* A store for entries that are not part of the catalog, e. g. for PATH suggestions */
+	static QSharedPointer<const EntryStore> detached(const QVector<EntryConfig> &entries);
+
+	const EntryConfig &at(int index) const;
+	int size() const;
+	int userCount() const;
+	bool isUserEntry(int index) const;
+	QVector<EntryConfig> userEntries() const;
+	QVector<EntryConfig> systemEntries() const;
+	/* Number of entries and their estimated size, shared strings counted once */
+	QJsonObject memoryReport() const;
+};
+
+typedef QSharedPointer<const EntryStore> EntryStorePtr;
+
+#endif // ENTRYSTORE_H
@@ -0,0 +1,34 @@
+#include "executesearchprovider.h"
+
+QString ExecuteSearchProvider::name() const
+{
+	return "execute";
+}
+
+int ExecuteSearchProvider::tier() const
+{
+	return 2;
+}
+
+int ExecuteSearchProvider::latencyBudget() const
+{
+	return 100;
+}
+
+void ExecuteSearchProvider::search(const QString &query, const CancellationToken &token,
+								   const SearchResultCallback &emitResults)
+{
+	Q_UNUSED(token);
+	QStringList arguments = query.split(" ");
+	EntryConfig e;
+	e.name = "Execute: " + query;
+	if(arguments.length() > 1)
+	{
+		e.arguments = arguments.mid(1);
+	}
+	e.command = arguments[0];
+	e.commandLine = query;
+	e.iconPath = "utilities-terminal";
+	e.type = EntryType::DYNAMIC;
+	emitResults(detachedResults({e}, {0}));
+}
@@ -0,0 +1,16 @@
+#ifndef EXECUTESEARCHPROVIDER_H
+#define EXECUTESEARCHPROVIDER_H
+#include "searchprovider.h"
+
+/* Last resort: offers to execute the query as a command */
+class ExecuteSearchProvider : public SearchProvider
+{
+  public:
+	QString name() const override;
+	int tier() const override;
+	int latencyBudget() const override;
+	void search(const QString &query, const CancellationToken &token,
+				const SearchResultCallback &emitResults) override;
+};
+
+#endif // EXECUTESEARCHPROVIDER_H
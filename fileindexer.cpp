@@ -0,0 +1,265 @@
+#include <QDebug>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "fileindexer.h"
+
+static const uint32_t WATCH_MASK =
+	IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+static const int SAVE_INTERVAL_MSECS = 5 * 60 * 1000;
+static const int ADD_BATCH_SIZE = 1024;
+
+FileIndexer::FileIndexer(QSharedPointer<FileNameIndex> index, QStringList roots, QStringList excludes,
+						 QString indexFilePath, CancellationToken token)
+{
+	this->index = index;
+	this->roots = roots;
+	this->indexFilePath = indexFilePath;
+	this->token = token;
+	for(const QString &exclude : excludes)
+	{
+		this->excludes.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(exclude)));
+	}
+}
+
+FileIndexer::~FileIndexer()
+{
+	if(this->inotifyFd != -1)
+	{
+		close(this->inotifyFd);
+	}
+}
+
+bool FileIndexer::isExcluded(const QString &name) const
+{
+	for(const QRegularExpression &exclude : this->excludes)
+	{
+		if(exclude.match(name).hasMatch())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FileIndexer::start()
+{
+	QElapsedTimer timer;
+	timer.start();
+	if(this->index->load(this->indexFilePath))
+	{
+		qInfo() << "Loaded file name index with" << this->index->size() << "paths in" << timer.elapsed() << "ms";
+	}
+
+	this->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(this->inotifyFd == -1)
+	{
+		qWarning() << "inotify_init1 failed, file name index will not be updated:" << strerror(errno);
+	}
+	else
+	{
+		this->notifier = new QSocketNotifier(this->inotifyFd, QSocketNotifier::Read, this);
+		connect(this->notifier, &QSocketNotifier::activated, this, &FileIndexer::readInotifyEvents);
+	}
+
+	rescan();
+
+	this->saveTimer = new QTimer(this);
+	connect(this->saveTimer, &QTimer::timeout, this, &FileIndexer::save);
+	this->saveTimer->start(SAVE_INTERVAL_MSECS);
+}
+
+void FileIndexer::save()
+{
+	if(this->index->isDirty() && !this->index->save(this->indexFilePath))
+	{
+		qWarning() << "Failed to save file name index to" << this->indexFilePath;
+	}
+}
+
+void FileIndexer::rescan()
+{
+	QElapsedTimer timer;
+	timer.start();
+	QSet<QString> seen;
+	for(const QString &root : this->roots)
+	{
+		QString path = QFileInfo(root).absoluteFilePath();
+		this->index->add({path});
+		seen.insert(path);
+		scan(path, &seen);
+	}
+	/* Incomplete, so we can't tell what was deleted. What was added is still worth saving */
+	if(this->token.isCancelled())
+	{
+		return;
+	}
+	/* Whatever we did not see anymore was deleted while we were not watching */
+	QStringList removed;
+	for(const QString &root : this->roots)
+	{
+		for(const QString &path : this->index->pathsBelow(QFileInfo(root).absoluteFilePath()))
+		{
+			if(!seen.contains(path))
+			{
+				removed.append(path);
+			}
+		}
+	}
+	this->index->remove(removed);
+	qInfo() << "Indexed" << seen.size() << "paths in" << timer.elapsed() << "ms";
+	save();
+}
+
+void FileIndexer::scan(const QString &dirPath, QSet<QString> *seen)
+{
+	QStringList batch;
+	QStringList pending{dirPath};
+	while(!pending.isEmpty() && !this->token.isCancelled())
+	{
+		QString current = pending.takeLast();
+		watchDirectory(current);
+		QDirIterator it(current, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+		while(it.hasNext())
+		{
+			QString path = it.next();
+			QFileInfo info = it.fileInfo();
+			if(isExcluded(info.fileName()))
+			{
+				continue;
+			}
+			batch.append(path);
+			if(seen != nullptr)
+			{
+				seen->insert(path);
+			}
+			if(info.isDir() && !info.isSymLink())
+			{
+				pending.append(path);
+			}
+			if(batch.size() >= ADD_BATCH_SIZE)
+			{
+				this->index->add(batch);
+				batch.clear();
+			}
+		}
+	}
+	this->index->add(batch);
+}
+
+void FileIndexer::watchDirectory(const QString &dirPath)
+{
+	if(this->inotifyFd == -1 || this->watchLimitReached)
+	{
+		return;
+	}
+	int wd = inotify_add_watch(this->inotifyFd, QFile::encodeName(dirPath).constData(), WATCH_MASK);
+	if(wd == -1)
+	{
+		if(errno == ENOSPC)
+		{
+			qWarning() << "inotify watch limit reached, file name index will only be updated partially."
+					   << "Consider raising fs.inotify.max_user_watches";
+			this->watchLimitReached = true;
+		}
+		return;
+	}
+	this->watches[wd] = dirPath;
+}
+
+/* Drops the watches of dirPath and everything below it */
+void FileIndexer::unwatchTree(const QString &dirPath)
+{
+	const QString prefix = dirPath + "/";
+	for(auto it = this->watches.begin(); it != this->watches.end();)
+	{
+		if(it.value() == dirPath || it.value().startsWith(prefix))
+		{
+			inotify_rm_watch(this->inotifyFd, it.key());
+			it = this->watches.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void FileIndexer::readInotifyEvents()
+{
+	alignas(struct inotify_event) char buffer[64 * 1024];
+	ssize_t len;
+	/* Directories moved away, by cookie. Unless the IN_MOVED_TO with the same cookie follows, they were
+	 * moved out of our roots and their watches would report paths below the old location */
+	QHash<uint32_t, QString> movedAway;
+	auto unwatchMovedAway = [this, &movedAway] {
+		for(const QString &path : qAsConst(movedAway))
+		{
+			unwatchTree(path);
+		}
+	};
+	while((len = read(this->inotifyFd, buffer, sizeof(buffer))) > 0)
+	{
+		for(char *ptr = buffer; ptr < buffer + len;)
+		{
+			const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if(event->mask & IN_Q_OVERFLOW)
+			{
+				qInfo() << "inotify queue overflowed, rescanning";
+				unwatchMovedAway();
+				rescan();
+				return;
+			}
+			if(event->mask & (IN_DELETE_SELF | IN_IGNORED))
+			{
+				this->watches.remove(event->wd);
+				continue;
+			}
+			if(event->len == 0 || !this->watches.contains(event->wd))
+			{
+				continue;
+			}
+			QString name = QFile::decodeName(event->name);
+			if(isExcluded(name))
+			{
+				continue;
+			}
+			QString path = this->watches[event->wd] + "/" + name;
+			if(event->mask & (IN_CREATE | IN_MOVED_TO))
+			{
+				if(event->mask & IN_MOVED_TO)
+				{
+					movedAway.remove(event->cookie);
+				}
+				this->index->add({path});
+				if(event->mask & IN_ISDIR)
+				{
+					/* A directory moved in may already have content. Re-adding the watch of a directory moved
+					 * within our roots returns the old descriptor, so its path gets updated too */
+					scan(path, nullptr);
+				}
+			}
+			else if(event->mask & (IN_DELETE | IN_MOVED_FROM))
+			{
+				if(event->mask & IN_ISDIR)
+				{
+					this->index->removeTree(path);
+					if(event->mask & IN_MOVED_FROM)
+					{
+						movedAway[event->cookie] = path;
+					}
+				}
+				else
+				{
+					this->index->remove({path});
+				}
+			}
+		}
+	}
+	unwatchMovedAway();
+}
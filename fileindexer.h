@@ -0,0 +1,48 @@
+#ifndef FILEINDEXER_H
+#define FILEINDEXER_H
+#include <QHash>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSocketNotifier>
+#include <QTimer>
+#include "cancellationtoken.h"
+#include "filenameindex.h"
+
+/* Keeps a FileNameIndex up to date. Lives in its own thread: loads the persisted index, rescans the
+ * roots once to catch changes made while we were not running and then follows changes through inotify. */
+class FileIndexer : public QObject
+{
+	Q_OBJECT
+  private:
+	QSharedPointer<FileNameIndex> index;
+	QStringList roots;
+	QVector<QRegularExpression> excludes;
+	QString indexFilePath;
+	/* Cancelled on shutdown, so a rescan does not hold it up */
+	CancellationToken token;
+	int inotifyFd = -1;
+	QSocketNotifier *notifier = nullptr;
+	QHash<int, QString> watches;
+	QTimer *saveTimer = nullptr;
+	bool watchLimitReached = false;
+
+	bool isExcluded(const QString &name) const;
+	void scan(const QString &dirPath, QSet<QString> *seen);
+	void rescan();
+	void watchDirectory(const QString &dirPath);
+	void unwatchTree(const QString &dirPath);
+	void readInotifyEvents();
+
+  public:
+	FileIndexer(QSharedPointer<FileNameIndex> index, QStringList roots, QStringList excludes,
+				QString indexFilePath, CancellationToken token);
+	~FileIndexer();
+
+  public slots:
+	void start();
+	void save();
+};
+
+#endif // FILEINDEXER_H
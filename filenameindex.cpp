@@ -0,0 +1,270 @@
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QReadLocker>
+#include <QSaveFile>
+#include <QWriteLocker>
+#include <algorithm>
+#include "filenameindex.h"
+
+static const quint32 INDEX_FILE_MAGIC = 0x71737466; // "qstf"
+static const quint32 INDEX_FILE_VERSION = 1;
+
+QVector<quint64> FileNameIndex::trigrams(const QString &lowercaseName)
+{
+	QVector<quint64> result;
+	for(int i = 0; i + 2 < lowercaseName.length(); i++)
+	{
+		quint64 trigram = (static_cast<quint64>(lowercaseName[i].unicode()) << 32) |
+						  (static_cast<quint64>(lowercaseName[i + 1].unicode()) << 16) |
+						  lowercaseName[i + 2].unicode();
+		result.append(trigram);
+	}
+	return result;
+}
+
+QStringRef FileNameIndex::fileName(const QString &path)
+{
+	return path.midRef(path.lastIndexOf('/') + 1);
+}
+
+void FileNameIndex::addUnlocked(const QString &path)
+{
+	if(this->ids.contains(path))
+	{
+		return;
+	}
+	qint32 id = this->paths.size();
+	this->paths.append(path);
+	this->ids[path] = id;
+	for(quint64 trigram : trigrams(fileName(path).toString().toLower()))
+	{
+		QVector<qint32> &list = this->postings[trigram];
+		/* a name can contain the same trigram multiple times */
+		if(list.isEmpty() || list.last() != id)
+		{
+			list.append(id);
+		}
+	}
+	this->dirty = true;
+}
+
+void FileNameIndex::removeUnlocked(const QString &path)
+{
+	auto it = this->ids.find(path);
+	if(it == this->ids.end())
+	{
+		return;
+	}
+	this->paths[it.value()].clear();
+	this->ids.erase(it);
+	++this->removedCount;
+	this->dirty = true;
+}
+
+void FileNameIndex::compactUnlocked()
+{
+	QVector<QString> remaining;
+	remaining.reserve(this->ids.size());
+	for(const QString &path : this->paths)
+	{
+		if(!path.isEmpty())
+		{
+			remaining.append(path);
+		}
+	}
+	this->paths.clear();
+	this->ids.clear();
+	this->postings.clear();
+	this->removedCount = 0;
+	for(const QString &path : remaining)
+	{
+		addUnlocked(path);
+	}
+}
+
+void FileNameIndex::add(const QStringList &paths)
+{
+	QWriteLocker locker(&this->lock);
+	for(const QString &path : paths)
+	{
+		addUnlocked(path);
+	}
+}
+
+void FileNameIndex::remove(const QStringList &paths)
+{
+	QWriteLocker locker(&this->lock);
+	for(const QString &path : paths)
+	{
+		removeUnlocked(path);
+	}
+	if(this->removedCount > this->paths.size() / 2)
+	{
+		compactUnlocked();
+	}
+}
+
+void FileNameIndex::removeTree(const QString &dirPath)
+{
+	QStringList below = pathsBelow(dirPath);
+	below.append(dirPath);
+	remove(below);
+}
+
+QStringList FileNameIndex::pathsBelow(const QString &dirPath) const
+{
+	QReadLocker locker(&this->lock);
+	QStringList result;
+	QString prefix = dirPath.endsWith('/') ? dirPath : dirPath + '/';
+	for(auto it = this->ids.constBegin(); it != this->ids.constEnd(); ++it)
+	{
+		if(it.key().startsWith(prefix))
+		{
+			result.append(it.key());
+		}
+	}
+	return result;
+}
+
+QStringList FileNameIndex::search(const QString &query, int limit, const CancellationToken &token) const
+{
+	QReadLocker locker(&this->lock);
+	QStringList result;
+	QString needle = query.toLower();
+	auto matches = [&needle](const QString &path) {
+		return !path.isEmpty() && fileName(path).contains(needle, Qt::CaseInsensitive);
+	};
+
+	if(needle.length() < 3)
+	{
+		/* Too short for trigrams, but then almost everything matches, so we won't scan far anyway */
+		for(int i = 0; i < this->paths.size() && result.size() < limit; i++)
+		{
+			if(i % 4096 == 0 && token.isCancelled())
+			{
+				return {};
+			}
+			if(matches(this->paths[i]))
+			{
+				result.append(this->paths[i]);
+			}
+		}
+		return result;
+	}
+
+	QVector<const QVector<qint32> *> lists;
+	for(quint64 trigram : trigrams(needle))
+	{
+		auto it = this->postings.constFind(trigram);
+		if(it == this->postings.constEnd())
+		{
+			return {};
+		}
+		lists.append(&it.value());
+	}
+	std::sort(lists.begin(), lists.end(),
+			  [](const QVector<qint32> *a, const QVector<qint32> *b) { return a->size() < b->size(); });
+
+	QVector<qint32> candidates = *lists[0];
+	for(int i = 1; i < lists.size() && !candidates.isEmpty(); i++)
+	{
+		if(token.isCancelled())
+		{
+			return {};
+		}
+		QVector<qint32> intersection;
+		std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+							  std::back_inserter(intersection));
+		candidates = intersection;
+	}
+
+	/* Trigrams only narrow it down, the order of them still needs to be verified */
+	for(qint32 id : candidates)
+	{
+		if(result.size() >= limit)
+		{
+			break;
+		}
+		if(matches(this->paths[id]))
+		{
+			result.append(this->paths[id]);
+		}
+	}
+	return result;
+}
+
+int FileNameIndex::size() const
+{
+	QReadLocker locker(&this->lock);
+	return this->ids.size();
+}
+
+bool FileNameIndex::isDirty() const
+{
+	QReadLocker locker(&this->lock);
+	return this->dirty;
+}
+
+bool FileNameIndex::load(const QString &indexFilePath)
+{
+	QFile file(indexFilePath);
+	if(!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	QDataStream stream(&file);
+	quint32 magic;
+	quint32 version;
+	stream >> magic >> version;
+	if(magic != INDEX_FILE_MAGIC || version != INDEX_FILE_VERSION)
+	{
+		qDebug() << "Ignoring file name index of unknown format: " << indexFilePath;
+		return false;
+	}
+	QVector<QString> paths;
+	QHash<quint64, QVector<qint32>> postings;
+	stream >> paths >> postings;
+	if(stream.status() != QDataStream::Ok)
+	{
+		qDebug() << "File name index is corrupt: " << indexFilePath;
+		return false;
+	}
+
+	QWriteLocker locker(&this->lock);
+	this->paths = paths;
+	this->postings = postings;
+	this->ids.clear();
+	this->ids.reserve(paths.size());
+	for(int i = 0; i < paths.size(); i++)
+	{
+		this->ids[paths[i]] = i;
+	}
+	this->removedCount = 0;
+	this->dirty = false;
+	return true;
+}
+
+bool FileNameIndex::save(const QString &indexFilePath)
+{
+	QWriteLocker locker(&this->lock);
+	if(this->removedCount > 0)
+	{
+		compactUnlocked();
+	}
+	QDir().mkpath(QFileInfo(indexFilePath).absolutePath());
+	QSaveFile file(indexFilePath);
+	if(!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+	QDataStream stream(&file);
+	stream << INDEX_FILE_MAGIC << INDEX_FILE_VERSION << this->paths << this->postings;
+	if(!file.commit())
+	{
+		return false;
+	}
+	this->dirty = false;
+	return true;
+}
@@ -0,0 +1,43 @@
+#ifndef FILENAMEINDEX_H
+#define FILENAMEINDEX_H
+#include <QHash>
+#include <QReadWriteLock>
+#include <QStringList>
+#include <QVector>
+#include "cancellationtoken.h"
+
+/* In-memory trigram index over file names. Thread-safe: the indexer writes while searches read.
+ * Every trigram of a lowercased file name maps to the ascending list of ids of paths containing it,
+ * so a substring query only has to look at the intersection of the lists of its trigrams. */
+class FileNameIndex
+{
+  private:
+	mutable QReadWriteLock lock;
+	/* id -> path. Removed paths are left empty until the next compaction, postings may still contain their ids */
+	QVector<QString> paths;
+	QHash<QString, qint32> ids;
+	QHash<quint64, QVector<qint32>> postings;
+	int removedCount = 0;
+	bool dirty = false;
+
+	static QVector<quint64> trigrams(const QString &lowercaseName);
+	static QStringRef fileName(const QString &path);
+	void addUnlocked(const QString &path);
+	void removeUnlocked(const QString &path);
+	void compactUnlocked();
+
+  public:
+	void add(const QStringList &paths);
+	void remove(const QStringList &paths);
+	/* Removes the directory and everything below it */
+	void removeTree(const QString &dirPath);
+	QStringList pathsBelow(const QString &dirPath) const;
+	QStringList search(const QString &query, int limit, const CancellationToken &token = {}) const;
+	int size() const;
+	bool isDirty() const;
+
+	bool load(const QString &indexFilePath);
+	bool save(const QString &indexFilePath);
+};
+
+#endif // FILENAMEINDEX_H
@@ -0,0 +1,63 @@
+#include <QMimeDatabase>
+#include "filesearchprovider.h"
+
+FileSearchProvider::FileSearchProvider(QStringList roots, QStringList excludes, QString indexFilePath)
+{
+	this->index.reset(new FileNameIndex());
+	this->indexer = new FileIndexer(this->index, roots, excludes, indexFilePath, this->indexerToken);
+	this->indexer->moveToThread(&this->indexerThread);
+	QObject::connect(&this->indexerThread, &QThread::started, this->indexer, &FileIndexer::start);
+	/* Its timers and notifier belong to that thread, so it must be deleted there */
+	QObject::connect(&this->indexerThread, &QThread::finished, this->indexer, &QObject::deleteLater);
+	this->indexerThread.start(QThread::LowestPriority);
+}
+
+FileSearchProvider::~FileSearchProvider()
+{
+	/* Lets a running rescan return first, the save would wait for it otherwise */
+	this->indexerToken.cancel();
+	QMetaObject::invokeMethod(this->indexer, &FileIndexer::save, Qt::BlockingQueuedConnection);
+	this->indexerThread.quit();
+	this->indexerThread.wait();
+}
+
+QString FileSearchProvider::name() const
+{
+	return "files";
+}
+
+int FileSearchProvider::latencyBudget() const
+{
+	return 200;
+}
+
+bool FileSearchProvider::handles(const QString &query) const
+{
+	return query.length() >= 2 && query[0] == '#';
+}
+
+void FileSearchProvider::search(const QString &query, const CancellationToken &token,
+								const SearchResultCallback &emitResults)
+{
+	QString needle = query.mid(1);
+	QStringList paths = this->index->search(needle, MAX_RESULTS, token);
+	if(paths.isEmpty() || token.isCancelled())
+	{
+		return;
+	}
+	QMimeDatabase mimeDatabase;
+	QVector<EntryConfig> entries;
+	QVector<int> scores;
+	for(const QString &path : paths)
+	{
+		EntryConfig e;
+		e.name = path.mid(path.lastIndexOf('/') + 1);
+		e.command = "xdg-open";
+		e.arguments = QStringList{path};
+		e.iconPath = mimeDatabase.mimeTypeForFile(path, QMimeDatabase::MatchExtension).iconName();
+		e.type = EntryType::DYNAMIC;
+		scores.append(e.name.startsWith(needle, Qt::CaseInsensitive) ? 0 : 1);
+		entries.append(e);
+	}
+	emitResults(detachedResults(entries, scores));
+}
@@ -0,0 +1,30 @@
+#ifndef FILESEARCHPROVIDER_H
+#define FILESEARCHPROVIDER_H
+#include <QSharedPointer>
+#include <QThread>
+#include "fileindexer.h"
+#include "filenameindex.h"
+#include "searchprovider.h"
+
+/* Searches file names below the configured roots, for queries starting with '#' */
+class FileSearchProvider : public SearchProvider
+{
+  private:
+	QSharedPointer<FileNameIndex> index;
+	CancellationToken indexerToken;
+	QThread indexerThread;
+	FileIndexer *indexer = nullptr;
+
+  public:
+	static const int MAX_RESULTS = 200;
+
+	FileSearchProvider(QStringList roots, QStringList excludes, QString indexFilePath);
+	~FileSearchProvider();
+	QString name() const override;
+	int latencyBudget() const override;
+	bool handles(const QString &query) const override;
+	void search(const QString &query, const CancellationToken &token,
+				const SearchResultCallback &emitResults) override;
+};
+
+#endif // FILESEARCHPROVIDER_H
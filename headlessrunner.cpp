@@ -0,0 +1,117 @@
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include "entrylauncher.h"
+#include "entrysearchprovider.h"
+#include "headlessrunner.h"
+
+HeadlessRunner::HeadlessRunner(EntryProvider &entryProvider, SettingsProvider &settingsProvider, Format format)
+	: out(stdout)
+{
+	this->entryProvider = &entryProvider;
+	this->settingsProvider = &settingsProvider;
+	this->format = format;
+}
+
+EntryStorePtr HeadlessRunner::loadEntries()
+{
+	return EntryStorePtr(new EntryStore(entryProvider->getUserEntries(), entryProvider->getSystemEntries()));
+}
+
+static QString typeName(EntryType type)
+{
+	switch(type)
+	{
+	case EntryType::USER:
+		return "user";
+	case EntryType::INHERIT:
+		return "inherit";
+	case EntryType::SYSTEM:
+		return "system";
+	case EntryType::DYNAMIC:
+		return "dynamic";
+	}
+	return {};
+}
+
+static QString tsvField(QString value)
+{
+	return value.replace('\t', ' ').replace('\n', ' ');
+}
+
+void HeadlessRunner::print(const QVector<SearchResult> &results)
+{
+	if(this->format == JSON)
+	{
+		QJsonArray array;
+		for(const SearchResult &result : results)
+		{
+			const EntryConfig &entry = result.entry();
+			QJsonObject object;
+			object["id"] = entry.entryPath;
+			object["name"] = entry.name;
+			object["command"] = entry.command;
+			object["arguments"] = QJsonArray::fromStringList(entry.arguments);
+			object["icon"] = entry.iconPath;
+			object["type"] = typeName(entry.type);
+			object["terminal"] = entry.isTerminalCommand;
+			object["score"] = result.score;
+			array.append(object);
+		}
+		out << QJsonDocument(array).toJson(QJsonDocument::Indented);
+	}
+	else
+	{
+		for(const SearchResult &result : results)
+		{
+			const EntryConfig &entry = result.entry();
+			QStringList commandLine = QStringList{entry.command} + entry.arguments;
+			out << tsvField(entry.entryPath) << '\t' << tsvField(entry.name) << '\t'
+				<< tsvField(commandLine.join(' ')) << '\t' << typeName(entry.type) << '\t' << result.score
+				<< '\n';
+		}
+	}
+	out.flush();
+}
+
+int HeadlessRunner::list()
+{
+	EntryStorePtr store = loadEntries();
+	QVector<SearchResult> results;
+	for(int i = 0; i < store->size(); i++)
+	{
+		SearchResult result;
+		result.store = store;
+		result.index = i;
+		results.append(result);
+	}
+	print(results);
+	return 0;
+}
+
+int HeadlessRunner::search(const QString &query)
+{
+	EntrySearchProvider provider;
+	provider.setEntries(loadEntries());
+	QVector<SearchResult> results;
+	provider.search(query, CancellationToken(), [&results](QVector<SearchResult> batch) { results.append(batch); });
+	/* Only the first batch comes in order, and everything is printed */
+	std::sort(results.begin(), results.end());
+	print(results);
+	return results.isEmpty() ? 1 : 0;
+}
+
+int HeadlessRunner::launch(const QString &id)
+{
+	EntryStorePtr store = loadEntries();
+	for(int i = 0; i < store->size(); i++)
+	{
+		if(store->at(i).entryPath == id)
+		{
+			return launchEntry(store->at(i), settingsProvider->getTerminalCommand()) ? 0 : 1;
+		}
+	}
+	QTextStream(stderr) << "No entry with id " << id << '\n';
+	return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+#include <QTextStream>
+#include "entryprovider.h"
+#include "entrystore.h"
+#include "searchprovider.h"
+#include "settingsprovider.h"
+
+/* Command line interface without any widgets, for scripts (dmenu style) and for testing the search on its own */
+class HeadlessRunner
+{
+  public:
+	enum Format
+	{
+		TSV,
+		JSON
+	};
+
+  private:
+	EntryProvider *entryProvider;
+	SettingsProvider *settingsProvider;
+	Format format;
+	QTextStream out;
+
+	EntryStorePtr loadEntries();
+	void print(const QVector<SearchResult> &results);
+
+  public:
+	HeadlessRunner(EntryProvider &entryProvider, SettingsProvider &settingsProvider, Format format);
+	int list();
+	int search(const QString &query);
+	int launch(const QString &id);
+};
+
+#endif // HEADLESSRUNNER_H
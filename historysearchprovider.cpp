@@ -0,0 +1,50 @@
+#include "historysearchprovider.h"
+
+HistorySearchProvider::HistorySearchProvider(QSharedPointer<CommandHistory> history)
+{
+	this->history = history;
+}
+
+QString HistorySearchProvider::name() const
+{
+	return "history";
+}
+
+int HistorySearchProvider::tier() const
+{
+	/* Together with "Execute:", which comes first as it runs what was typed */
+	return 2;
+}
+
+int HistorySearchProvider::latencyBudget() const
+{
+	return 100;
+}
+
+void HistorySearchProvider::search(const QString &query, const CancellationToken &token,
+								   const SearchResultCallback &emitResults)
+{
+	Q_UNUSED(token);
+	QStringList lines = this->history->suggestions(query, MAX_SUGGESTIONS + 1);
+	/* The same as "Execute:" */
+	lines.removeAll(query);
+	QVector<EntryConfig> entries;
+	QVector<int> scores;
+	for(int i = 0; i < lines.size() && i < MAX_SUGGESTIONS; i++)
+	{
+		QStringList arguments = lines[i].split(" ");
+		EntryConfig e;
+		e.name = lines[i];
+		e.command = arguments[0];
+		e.arguments = arguments.mid(1);
+		e.commandLine = lines[i];
+		e.iconPath = "document-open-recent";
+		e.type = EntryType::DYNAMIC;
+		entries.append(e);
+		scores.append(1 + i);
+	}
+	if(!entries.isEmpty())
+	{
+		emitResults(detachedResults(entries, scores));
+	}
+}
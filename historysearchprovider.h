@@ -0,0 +1,24 @@
+#ifndef HISTORYSEARCHPROVIDER_H
+#define HISTORYSEARCHPROVIDER_H
+#include <QSharedPointer>
+#include "commandhistory.h"
+#include "searchprovider.h"
+
+/* Suggests previously run command lines, below the "Execute:" fallback */
+class HistorySearchProvider : public SearchProvider
+{
+  private:
+	QSharedPointer<CommandHistory> history;
+
+  public:
+	static const int MAX_SUGGESTIONS = 5;
+
+	HistorySearchProvider(QSharedPointer<CommandHistory> history);
+	QString name() const override;
+	int tier() const override;
+	int latencyBudget() const override;
+	void search(const QString &query, const CancellationToken &token,
+				const SearchResultCallback &emitResults) override;
+};
+
+#endif // HISTORYSEARCHPROVIDER_H
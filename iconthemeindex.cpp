@@ -0,0 +1,337 @@
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include "iconthemeindex.h"
+
+static const quint32 ICON_INDEX_MAGIC = 0x71737469;
+static const quint32 ICON_INDEX_VERSION = 2;
+static const char *FALLBACK_THEME = "hicolor";
+static const char *PIXMAPS_DIRECTORY = "/usr/share/pixmaps";
+
+static const QStringList ICON_SUFFIXES = {"png", "svg", "xpm"};
+
+IconThemeIndex &IconThemeIndex::instance()
+{
+	static IconThemeIndex index;
+	return index;
+}
+
+QString IconThemeIndex::cacheFilePath()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/icontheme.idx";
+}
+
+static qint64 modificationTime(const QString &path)
+{
+	return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+QStringList IconThemeIndex::themeDirectories(const QString &theme, const QStringList &searchPaths)
+{
+	QStringList result;
+	for(const QString &searchPath : searchPaths)
+	{
+		/* Resource paths have no mtime and are handled by QIcon::fromTheme() */
+		if(searchPath.startsWith(':'))
+		{
+			continue;
+		}
+		QString directory = searchPath + "/" + theme;
+		if(QFileInfo(directory + "/index.theme").exists())
+		{
+			result.append(directory);
+		}
+	}
+	return result;
+}
+
+void IconThemeIndex::scanTheme(Index &index, const QString &theme, const QStringList &searchPaths,
+							   QStringList &visited)
+{
+	if(visited.contains(theme))
+	{
+		return;
+	}
+	visited.append(theme);
+
+	QStringList themeDirs = themeDirectories(theme, searchPaths);
+	if(themeDirs.isEmpty())
+	{
+		return;
+	}
+	QSettings themeIndex(themeDirs.first() + "/index.theme", QSettings::IniFormat);
+	QStringList subDirs = themeIndex.value("Icon Theme/Directories").toStringList();
+	QStringList parents = themeIndex.value("Icon Theme/Inherits").toStringList();
+
+	QHash<QString, QVector<IconFile>> own;
+	for(const QString &themeDir : themeDirs)
+	{
+		index.directoryTimes[themeDir] = modificationTime(themeDir);
+		/* Edited in place, e. g. its Inherits or Directories, it leaves the directory's mtime alone */
+		index.directoryTimes[themeDir + "/index.theme"] = modificationTime(themeDir + "/index.theme");
+		for(const QString &subDir : subDirs)
+		{
+			themeIndex.beginGroup(subDir);
+			int size = themeIndex.value("Size").toInt();
+			int scale = themeIndex.value("Scale", 1).toInt();
+			themeIndex.endGroup();
+			/* Scaled directories duplicate the plain ones for HiDPI, QIcon scales on its own */
+			if(scale != 1)
+			{
+				continue;
+			}
+			QString path = themeDir + "/" + subDir;
+			QDir dir(path);
+			if(!dir.exists())
+			{
+				continue;
+			}
+			index.directoryTimes[path] = modificationTime(path);
+			for(const QString &file : dir.entryList(QDir::Files | QDir::NoDotAndDotDot))
+			{
+				int dot = file.lastIndexOf('.');
+				if(dot <= 0 || !ICON_SUFFIXES.contains(file.mid(dot + 1)))
+				{
+					continue;
+				}
+				own[file.left(dot)].append({path + "/" + file, size});
+			}
+		}
+	}
+
+	/* Names the theme provides itself take precedence over its parents */
+	for(auto it = own.begin(); it != own.end(); ++it)
+	{
+		if(!index.icons.contains(it.key()))
+		{
+			index.icons.insert(it.key(), it.value());
+		}
+	}
+	for(const QString &parent : parents)
+	{
+		scanTheme(index, parent.trimmed(), searchPaths, visited);
+	}
+}
+
+void IconThemeIndex::scanPixmaps(Index &index, const QString &directory)
+{
+	QDir dir(directory);
+	if(!dir.exists())
+	{
+		return;
+	}
+	index.directoryTimes[directory] = modificationTime(directory);
+	for(const QString &file : dir.entryList(QDir::Files | QDir::NoDotAndDotDot))
+	{
+		int dot = file.lastIndexOf('.');
+		if(dot <= 0 || !ICON_SUFFIXES.contains(file.mid(dot + 1)))
+		{
+			continue;
+		}
+		QString name = file.left(dot);
+		if(!index.icons.contains(name))
+		{
+			index.icons[name].append({directory + "/" + file, 0});
+		}
+	}
+}
+
+void IconThemeIndex::build(Index &index, const QString &theme)
+{
+	index.icons.clear();
+	index.directoryTimes.clear();
+	index.themeName = theme;
+
+	QStringList searchPaths = QIcon::themeSearchPaths();
+	QStringList visited;
+	if(!theme.isEmpty())
+	{
+		scanTheme(index, theme, searchPaths, visited);
+	}
+	/* Every theme implicitly inherits from hicolor, which is searched last */
+	visited.removeAll(FALLBACK_THEME);
+	scanTheme(index, FALLBACK_THEME, searchPaths, visited);
+	scanPixmaps(index, PIXMAPS_DIRECTORY);
+}
+
+bool IconThemeIndex::isUpToDate(const QHash<QString, qint64> &directoryTimes)
+{
+	for(auto it = directoryTimes.begin(); it != directoryTimes.end(); ++it)
+	{
+		if(modificationTime(it.key()) != it.value())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IconThemeIndex::loadCache(Index &index, const QString &theme)
+{
+	QFile file(cacheFilePath());
+	if(!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	QDataStream stream(&file);
+	quint32 magic;
+	quint32 version;
+	QString cachedTheme;
+	QStringList searchPaths;
+	stream >> magic >> version;
+	if(magic != ICON_INDEX_MAGIC || version != ICON_INDEX_VERSION)
+	{
+		return false;
+	}
+	stream >> cachedTheme >> searchPaths;
+	if(cachedTheme != theme || searchPaths != QIcon::themeSearchPaths())
+	{
+		return false;
+	}
+	QHash<QString, qint64> directoryTimes;
+	qint32 count;
+	stream >> directoryTimes >> count;
+	QHash<QString, QVector<IconFile>> icons;
+	icons.reserve(count);
+	for(qint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+	{
+		QString name;
+		qint32 fileCount;
+		stream >> name >> fileCount;
+		QVector<IconFile> &files = icons[name];
+		files.reserve(fileCount);
+		for(qint32 j = 0; j < fileCount; j++)
+		{
+			IconFile iconFile;
+			stream >> iconFile.path >> iconFile.size;
+			files.append(iconFile);
+		}
+	}
+	if(stream.status() != QDataStream::Ok)
+	{
+		qDebug() << "Icon theme index is corrupt, rebuilding";
+		return false;
+	}
+	index.themeName = cachedTheme;
+	index.directoryTimes = directoryTimes;
+	index.icons = icons;
+	return isUpToDate(index.directoryTimes);
+}
+
+void IconThemeIndex::saveCache(const Index &index)
+{
+	QString path = cacheFilePath();
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	QSaveFile file(path);
+	if(!file.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+	QDataStream stream(&file);
+	stream << ICON_INDEX_MAGIC << ICON_INDEX_VERSION << index.themeName << QIcon::themeSearchPaths()
+		   << index.directoryTimes << qint32(index.icons.size());
+	for(auto it = index.icons.begin(); it != index.icons.end(); ++it)
+	{
+		stream << it.key() << qint32(it.value().size());
+		for(const IconFile &iconFile : it.value())
+		{
+			stream << iconFile.path << qint32(iconFile.size);
+		}
+	}
+	if(!file.commit())
+	{
+		qDebug() << "Failed to save icon theme index: " << file.errorString();
+	}
+}
+
+void IconThemeIndex::ensureLoaded()
+{
+	QMutexLocker loadLocker(&this->loadMutex);
+	QString theme = QIcon::themeName();
+	QHash<QString, qint64> directoryTimes;
+	{
+		QMutexLocker locker(&this->mutex);
+		if(this->loaded && theme == this->index.themeName)
+		{
+			directoryTimes = this->index.directoryTimes;
+		}
+	}
+	/* Lookups go on with the current index meanwhile */
+	if(!directoryTimes.isEmpty() && isUpToDate(directoryTimes))
+	{
+		return;
+	}
+	/* If the current index is out of date, so is the cached one */
+	const bool stale = !directoryTimes.isEmpty();
+	Index fresh;
+	if(stale || !loadCache(fresh, theme))
+	{
+		build(fresh, theme);
+		saveCache(fresh);
+	}
+	QMutexLocker locker(&this->mutex);
+	this->index = std::move(fresh);
+	this->loaded = true;
+}
+
+QVector<IconThemeIndex::IconFile> IconThemeIndex::files(const QString &name) const
+{
+	/* Desktop files sometimes carry the suffix */
+	QString key = name;
+	int dot = key.lastIndexOf('.');
+	if(dot > 0 && ICON_SUFFIXES.contains(key.mid(dot + 1)))
+	{
+		key.truncate(dot);
+	}
+	QMutexLocker locker(&this->mutex);
+	return this->index.icons.value(key);
+}
+
+QString IconThemeIndex::iconFile(const QString &name, int size)
+{
+	QVector<IconFile> files = this->files(name);
+	QString best;
+	int bestSize = -1;
+	for(const IconFile &file : files)
+	{
+		if(file.path.endsWith(".svg"))
+		{
+			return file.path;
+		}
+		/* The smallest one that needs no upscaling, otherwise the largest */
+		bool better = bestSize < size ? file.size > bestSize : (file.size >= size && file.size < bestSize);
+		if(better)
+		{
+			best = file.path;
+			bestSize = file.size;
+		}
+	}
+	return best;
+}
+
+QIcon IconThemeIndex::icon(const QString &name)
+{
+	QIcon result;
+	for(const IconFile &file : files(name))
+	{
+		result.addFile(file.path, file.size > 0 ? QSize(file.size, file.size) : QSize());
+	}
+	return result;
+}
+
+QJsonObject IconThemeIndex::memoryReport() const
+{
+	QMutexLocker locker(&this->mutex);
+	int files = 0;
+	for(const QVector<IconFile> &iconFiles : this->index.icons)
+	{
+		files += iconFiles.size();
+	}
+	return {{"names", this->index.icons.size()},
+			{"files", files},
+			{"directories", this->index.directoryTimes.size()}};
+}
@@ -0,0 +1,63 @@
+#ifndef ICONTHEMEINDEX_H
+#define ICONTHEMEINDEX_H
+#include <QHash>
+#include <QIcon>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/* Maps icon names to the files of the current icon theme (and the themes it inherits from),
+ * so resolving an icon name is a hash lookup instead of probing every size directory.
+ *
+ * The index is persisted and only rebuilt when one of the scanned directories or index.theme
+ * files changed. It is loaded or built by ensureLoaded() on a worker, lookups never wait for that. */
+class IconThemeIndex
+{
+  private:
+	struct IconFile
+	{
+		QString path;
+		int size;
+	};
+	struct Index
+	{
+		QString themeName;
+		QHash<QString, QVector<IconFile>> icons;
+		/* Every scanned directory and index.theme file with its mtime, to notice changes */
+		QHash<QString, qint64> directoryTimes;
+	};
+
+	/* Only held for lookups and to swap in a new index */
+	mutable QMutex mutex;
+	/* One ensureLoaded() at a time */
+	QMutex loadMutex;
+	bool loaded = false;
+	Index index;
+
+	static QString cacheFilePath();
+	static QStringList themeDirectories(const QString &theme, const QStringList &searchPaths);
+	static void scanTheme(Index &index, const QString &theme, const QStringList &searchPaths, QStringList &visited);
+	static void scanPixmaps(Index &index, const QString &directory);
+	static void build(Index &index, const QString &theme);
+	static bool loadCache(Index &index, const QString &theme);
+	static void saveCache(const Index &index);
+	static bool isUpToDate(const QHash<QString, qint64> &directoryTimes);
+	QVector<IconFile> files(const QString &name) const;
+
+  public:
+	static IconThemeIndex &instance();
+	/* Loads the index, or builds it if there is none or its directories changed. Blocks, so it
+	 * belongs on a worker. Called again (e. g. on reload), it checks the directories again */
+	void ensureLoaded();
+	/* A null icon if the name is not part of the index */
+	QIcon icon(const QString &name);
+	/* The file that renders best at size, scalable ones preferred. Empty if the name is unknown,
+	 * or the index is not loaded yet */
+	QString iconFile(const QString &name, int size);
+	/* Number of indexed names, files and directories */
+	QJsonObject memoryReport() const;
+};
+
+#endif // ICONTHEMEINDEX_H
@@ -0,0 +1,260 @@
+#include <QApplication>
+#include <QDebug>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include "calculationengine.h"
+#include "entryprovider.h"
+#include "latencybenchmark.h"
+#include "memoryaccounting.h"
+#include "settingsprovider.h"
+#include "window.h"
+
+/* How long a single step may take before the benchmark gives up */
+static const int SETTLE_TIMEOUT_MSECS = 10000;
+/* p90 each scenario must stay below, in ms. A frame at 60 Hz is about 16 ms */
+static const QMap<QString, double> P90_THRESHOLDS_MSECS = {
+	{"search", 16}, {"backspace", 16}, {"path-fallback", 16}, {"calculation", 16}, {"ctrl-shortcuts", 8}};
+/* How much slower than the baseline a p90 may be, relative and absolute, to absorb noise */
+static const double BASELINE_TOLERANCE_FACTOR = 1.25;
+static const double BASELINE_TOLERANCE_MSECS = 1;
+
+static const QStringList WORDS = {"fire", "term", "edit", "mail", "play", "view", "calc", "note",
+								  "chat", "draw", "scan", "sync", "code", "book", "map",  "wave"};
+
+LatencyBenchmark::LatencyBenchmark(const QString &baselinePath) : out(stdout), baselinePath(baselinePath)
+{
+}
+
+static bool writeFile(const QString &path, const QString &content)
+{
+	QFile file(path);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		return false;
+	}
+	return file.write(content.toUtf8()) == content.toUtf8().size();
+}
+
+bool LatencyBenchmark::createCatalog(int userEntries, int systemEntries)
+{
+	QString configPath = this->directory.path() + "/config";
+	QString applicationsPath = this->directory.path() + "/applications";
+	if(!QDir().mkpath(configPath) || !QDir().mkpath(applicationsPath))
+	{
+		return false;
+	}
+	for(int i = 0; i < systemEntries; i++)
+	{
+		QString name = WORDS[i % WORDS.size()] + WORDS[(i / WORDS.size()) % WORDS.size()] + QString::number(i);
+		QString content = QString("[Desktop Entry]\nType=Application\nName=%1\nExec=/bin/true %2\nIcon=%3\n")
+							  .arg(name, QString::number(i), i % 2 ? "utilities-terminal" : "");
+		if(!writeFile(applicationsPath + "/" + name + ".desktop", content))
+		{
+			return false;
+		}
+	}
+	for(int i = 0; i < userEntries; i++)
+	{
+		QString content = QString("name %1fav%2\ncommand /bin/true\nrow %3\ncol %4\n")
+							  .arg(WORDS[i % WORDS.size()])
+							  .arg(i)
+							  .arg(i / 3)
+							  .arg(i % 3);
+		if(!writeFile(configPath + "/" + QString::number(i) + ".qsrun", content))
+		{
+			return false;
+		}
+	}
+	QSettings settings(configPath + "/qsrun.config", QSettings::NativeFormat);
+	settings.setValue("sysAppsPaths", QStringList{applicationsPath});
+	settings.setValue("singleInstance", false);
+	settings.setValue("fileSearch", false);
+	settings.setValue("contentSearch", false);
+	settings.setValue("stallThreshold", 0);
+	settings.sync();
+	return settings.status() == QSettings::NoError;
+}
+
+/* Processes events until the window has nothing left to do, then lays it out and paints it */
+bool LatencyBenchmark::waitUntilSettled(Window &window)
+{
+	QDeadlineTimer deadline(SETTLE_TIMEOUT_MSECS);
+	do
+	{
+		QCoreApplication::processEvents(QEventLoop::AllEvents);
+		if(deadline.hasExpired())
+		{
+			return false;
+		}
+	} while(window.isBusy());
+	QCoreApplication::sendPostedEvents(nullptr, QEvent::LayoutRequest);
+	window.repaint();
+	return true;
+}
+
+void LatencyBenchmark::sendKey(Window &window, const QString &scenario, int key, Qt::KeyboardModifiers modifiers,
+							   const QString &text)
+{
+	QWidget *target = window.focusWidget() != nullptr ? window.focusWidget() : &window;
+	QKeyEvent press(QEvent::KeyPress, key, modifiers, text);
+	QKeyEvent release(QEvent::KeyRelease, key, modifiers, text);
+	QElapsedTimer timer;
+	timer.start();
+	QApplication::sendEvent(target, &press);
+	QApplication::sendEvent(target, &release);
+	if(!waitUntilSettled(window))
+	{
+		qWarning() << scenario << "did not settle within" << SETTLE_TIMEOUT_MSECS << "ms";
+	}
+	this->samples[scenario].append(timer.nsecsElapsed());
+}
+
+void LatencyBenchmark::type(Window &window, const QString &scenario, const QString &text)
+{
+	for(QChar c : text)
+	{
+		sendKey(window, scenario, c.toUpper().unicode(), Qt::NoModifier, QString(c));
+	}
+}
+
+void LatencyBenchmark::erase(Window &window, const QString &scenario, int count)
+{
+	for(int i = 0; i < count; i++)
+	{
+		sendKey(window, scenario, Qt::Key_Backspace, Qt::NoModifier);
+	}
+}
+
+/* In ms, of samples sorted ascending */
+double LatencyBenchmark::percentile(const QVector<qint64> &sorted, int p)
+{
+	int rank = std::max(1, (p * sorted.size() + 99) / 100);
+	return sorted[rank - 1] / 1e6;
+}
+
+void LatencyBenchmark::report()
+{
+	this->out << "scenario\tsamples\tp50 ms\tp90 ms\tp99 ms\tmax ms" << Qt::endl;
+	for(auto it = this->samples.begin(); it != this->samples.end(); ++it)
+	{
+		QVector<qint64> values = it.value();
+		std::sort(values.begin(), values.end());
+		this->out << it.key() << "\t" << values.size() << "\t" << QString::number(percentile(values, 50), 'f', 2)
+				  << "\t" << QString::number(percentile(values, 90), 'f', 2) << "\t"
+				  << QString::number(percentile(values, 99), 'f', 2) << "\t"
+				  << QString::number(values.last() / 1e6, 'f', 2) << Qt::endl;
+	}
+}
+
+/* The p90 column of a previous report */
+bool LatencyBenchmark::readBaseline(const QString &path, QMap<QString, double> &p90s)
+{
+	QFile file(path);
+	if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return false;
+	}
+	while(!file.atEnd())
+	{
+		QList<QByteArray> fields = file.readLine().trimmed().split('\t');
+		bool ok = false;
+		double p90 = fields.size() >= 4 ? fields[3].toDouble(&ok) : 0;
+		if(ok)
+		{
+			p90s[QString::fromUtf8(fields[0])] = p90;
+		}
+	}
+	return true;
+}
+
+bool LatencyBenchmark::check()
+{
+	QMap<QString, double> baseline;
+	if(!this->baselinePath.isEmpty() && !readBaseline(this->baselinePath, baseline))
+	{
+		qCritical() << "Failed to read the baseline" << this->baselinePath;
+		return false;
+	}
+	bool passed = true;
+	for(auto it = this->samples.begin(); it != this->samples.end(); ++it)
+	{
+		QVector<qint64> values = it.value();
+		std::sort(values.begin(), values.end());
+		double p90 = percentile(values, 90);
+		double threshold = P90_THRESHOLDS_MSECS.value(it.key(), 0);
+		if(threshold > 0 && p90 > threshold)
+		{
+			this->out << "FAIL\t" << it.key() << "\tp90 " << QString::number(p90, 'f', 2) << " ms exceeds "
+					  << threshold << " ms" << Qt::endl;
+			passed = false;
+		}
+		if(baseline.contains(it.key()))
+		{
+			double limit = baseline[it.key()] * BASELINE_TOLERANCE_FACTOR + BASELINE_TOLERANCE_MSECS;
+			if(p90 > limit)
+			{
+				this->out << "FAIL\t" << it.key() << "\tp90 " << QString::number(p90, 'f', 2)
+						  << " ms regressed from " << QString::number(baseline[it.key()], 'f', 2)
+						  << " ms in the baseline" << Qt::endl;
+				passed = false;
+			}
+		}
+	}
+	return passed;
+}
+
+int LatencyBenchmark::run()
+{
+	/* Keep caches and logs of the benchmark out of the real ones */
+	QStandardPaths::setTestModeEnabled(true);
+	if(!this->directory.isValid() || !createCatalog(USER_ENTRIES, SYSTEM_ENTRIES))
+	{
+		qCritical() << "Failed to create the synthetic catalog";
+		return 1;
+	}
+	QString configPath = this->directory.path() + "/config/";
+	QSettings settings(configPath + "qsrun.config", QSettings::NativeFormat);
+	SettingsProvider settingsProvider{settings};
+	EntryProvider entryProvider(settingsProvider.userEntriesPaths(), settingsProvider.systemApplicationsEntriesPaths());
+
+	QElapsedTimer startup;
+	startup.start();
+	Window window{entryProvider, settingsProvider};
+	window.resize(1280, 800);
+	window.show();
+	QApplication::setActiveWindow(&window);
+	window.focusInput();
+	if(!waitUntilSettled(window))
+	{
+		qCritical() << "The catalog did not load";
+		return 1;
+	}
+	/* What the catalog and its buttons cost, to compare changes to them */
+	qint64 rss = MemoryAccounting::instance().toJson()["process"].toObject()["vmrss_bytes"].toVariant().toLongLong();
+	this->out << "# Startup until the catalog is shown: " << startup.elapsed() << " ms" << Qt::endl;
+	this->out << "# RSS with " << USER_ENTRIES + SYSTEM_ENTRIES << " entries loaded: "
+			  << QString::number(rss / 1048576.0, 'f', 1) << " MiB" << Qt::endl;
+
+	for(int i = 0; i < ITERATIONS; i++)
+	{
+		QString word = WORDS[i % WORDS.size()];
+		type(window, "search", word);
+		sendKey(window, "ctrl-shortcuts", Qt::Key_Control, Qt::ControlModifier);
+		erase(window, "backspace", word.size());
+		type(window, "path-fallback", "qsrunbenchnonexistent");
+		erase(window, "backspace", QString("qsrunbenchnonexistent").size());
+		type(window, "calculation", QString("=%1*7+3").arg(i));
+		erase(window, "backspace", QString("=%1*7+3").arg(i).size());
+	}
+	report();
+	/* Plain arithmetic must not need it */
+	this->out << "# Calculator plugin loaded: " << (CalculationEngine::isPluginLoaded() ? "yes" : "no") << Qt::endl;
+	return check() ? 0 : 1;
+}
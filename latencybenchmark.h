@@ -0,0 +1,45 @@
+#ifndef LATENCYBENCHMARK_H
+#define LATENCYBENCHMARK_H
+#include <QMap>
+#include <QString>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+class Window;
+
+/* Types scripted queries into a Window with a synthetic catalog and reports how long it takes from
+ * a key event until the window has settled, laid out and painted. Meant to run on the offscreen
+ * platform (--latency-bench sets it) to catch UI regressions without a display.
+ *
+ * Fails if the p90 of a scenario exceeds its threshold or, given a baseline (an earlier report),
+ * is notably slower than there */
+class LatencyBenchmark
+{
+  private:
+	QTemporaryDir directory;
+	QTextStream out;
+	QString baselinePath;
+	QMap<QString, QVector<qint64>> samples;
+
+	bool createCatalog(int userEntries, int systemEntries);
+	static bool waitUntilSettled(Window &window);
+	void sendKey(Window &window, const QString &scenario, int key, Qt::KeyboardModifiers modifiers,
+				 const QString &text = QString());
+	void type(Window &window, const QString &scenario, const QString &text);
+	void erase(Window &window, const QString &scenario, int count);
+	static double percentile(const QVector<qint64> &sorted, int p);
+	static bool readBaseline(const QString &path, QMap<QString, double> &p90s);
+	void report();
+	bool check();
+
+  public:
+	static const int USER_ENTRIES = 30;
+	static const int SYSTEM_ENTRIES = 2000;
+	static const int ITERATIONS = 20;
+
+	explicit LatencyBenchmark(const QString &baselinePath = QString());
+	int run();
+};
+
+#endif // LATENCYBENCHMARK_H
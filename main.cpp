@@ -21,32 +21,85 @@
 #include <QSettings>
 #include <QLocalSocket>
 #include <QDir>
+#include <algorithm>
 #include "settingsprovider.h"
 #include "entryprovider.h"
+#include "headlessrunner.h"
 #include "window.h"
+#include "latencybenchmark.h"
+#include "calculatorcheck.h"
+#include "matchbenchmark.h"
 #include "singleinstanceserver.h"
 
 int main(int argc, char *argv[])
 {
-	QApplication app(argc, argv);
+	/* The headless modes must not connect to a display, so decide before creating the application */
+	bool headless = false;
+	for(int i = 1; i < argc; i++)
+	{
+		QString arg = argv[i];
+		for(const QString &option : {"--search", "--list", "--launch", "--match-bench", "--calculator-check"})
+		{
+			headless = headless || arg == option || arg.startsWith(option + "=");
+		}
+	}
+	/* Needs no display either, but a real window */
+	bool latencyBenchmark =
+		std::any_of(argv + 1, argv + argc, [](const char *arg) { return QString(arg) == "--latency-bench"; });
+	if(latencyBenchmark)
+	{
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QScopedPointer<QCoreApplication> app(headless ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+
 	QString configDirectoryPath;
 	QDir dir;
 	bool newInstanceRequested = false;
+	bool daemonRequested = false;
+	QCommandLineParser parser;
 	if(argc >= 2)
 	{
-		QCommandLineParser parser;
 		parser.addOptions({
 			{"new-instance", "Launch a new instance, ignoring any running ones"},
-			{"config", "Use supplied config dir instead of default"},
+			{"daemon", "Start without showing the window, it is shown when qsrun is started again"},
+			{"config", "Use supplied config dir instead of default", "directory"},
+			{"search", "Print the entries matching <query> and exit", "query"},
+			{"list", "Print all entries and exit"},
+			{"launch", "Launch the entry with the given id (its path, as printed by --list) and exit", "id"},
+			{"format", "Output format of --search and --list: tsv (default) or json", "format", "tsv"},
+			{"latency-bench", "Measure the latency of typing into the window with a synthetic catalog and exit"},
+			{"latency-baseline", "Fail --latency-bench if it is notably slower than this earlier report of it", "file"},
+			{"match-bench", "Measure how matching a large synthetic catalog scales with cores and exit"},
+			{"calculator-check", "Compare the calculator's fast path with libqalculate on a fixed set of expressions and exit"},
 		});
 		parser.addHelpOption();
-		parser.process(app.arguments());
+		parser.process(app->arguments());
+		if(latencyBenchmark)
+		{
+			return LatencyBenchmark(parser.value("latency-baseline")).run();
+		}
+		if(parser.isSet("match-bench"))
+		{
+			return MatchBenchmark().run();
+		}
+		if(parser.isSet("calculator-check"))
+		{
+			return CalculatorCheck().run();
+		}
 		configDirectoryPath = parser.value("config");
 		newInstanceRequested = parser.isSet("new-instance");
+		daemonRequested = parser.isSet("daemon");
 
 		if(!configDirectoryPath.isEmpty() && !dir.exists(configDirectoryPath))
 		{
-			QMessageBox::warning(nullptr, "Directory not found", configDirectoryPath + " was not found");
+			if(headless)
+			{
+				qCritical() << configDirectoryPath << "was not found";
+			}
+			else
+			{
+				QMessageBox::warning(nullptr, "Directory not found", configDirectoryPath + " was not found");
+			}
 			return 1;
 		}
 	}
@@ -61,8 +114,15 @@ int main(int argc, char *argv[])
 	{
 		if(!dir.mkdir(configDirectoryPath))
 		{
-			QMessageBox::warning(nullptr, "Failed to create dir",
-								 configDirectoryPath + " was not found and could not be created!");
+			if(headless)
+			{
+				qCritical() << configDirectoryPath << "was not found and could not be created!";
+			}
+			else
+			{
+				QMessageBox::warning(nullptr, "Failed to create dir",
+									 configDirectoryPath + " was not found and could not be created!");
+			}
 			return 1;
 		}
 	}
@@ -72,15 +132,50 @@ int main(int argc, char *argv[])
 	SettingsProvider settingsProvider{settings};
 	EntryProvider entryProvider(settingsProvider.userEntriesPaths(), settingsProvider.systemApplicationsEntriesPaths());
 
+	if(headless)
+	{
+		QString format = parser.value("format");
+		if(format != "tsv" && format != "json")
+		{
+			qCritical() << "Unknown format:" << format;
+			return 1;
+		}
+		HeadlessRunner runner(entryProvider, settingsProvider,
+							  format == "json" ? HeadlessRunner::JSON : HeadlessRunner::TSV);
+		try
+		{
+			if(parser.isSet("launch"))
+			{
+				return runner.launch(parser.value("launch"));
+			}
+			if(parser.isSet("search"))
+			{
+				return runner.search(parser.value("search"));
+			}
+			return runner.list();
+		}
+		catch(const std::exception &e)
+		{
+			qCritical() << "Error:" << e.what();
+			return 1;
+		}
+	}
+
 	SingleInstanceServer *server = nullptr;
 
-	bool singleInstanceMode = !newInstanceRequested && settingsProvider.singleInstanceMode();
+	/* A daemon is only useful if it can be asked to show up */
+	bool singleInstanceMode = daemonRequested || (!newInstanceRequested && settingsProvider.singleInstanceMode());
 	if(singleInstanceMode)
 	{
 		QLocalSocket localSocket;
 		localSocket.connectToServer(settingsProvider.socketPath());
 		if(localSocket.isOpen() && localSocket.isWritable())
 		{
+			if(daemonRequested)
+			{
+				qInfo() << "Already running";
+				return 0;
+			}
 			QDataStream stream(&localSocket);
 			stream << (int)0x01; // maximize
 			localSocket.flush();
@@ -112,8 +207,18 @@ int main(int argc, char *argv[])
 		});
 	}
 
-	w->showMaximized();
-	w->focusInput();
+	if(daemonRequested)
+	{
+		/* Do what can be done without showing, so the first request shows up without delay */
+		w->setResident(true);
+		w->ensurePolished();
+		w->winId();
+	}
+	else
+	{
+		w->showMaximized();
+		w->focusInput();
+	}
 
-	return app.exec();
+	return app->exec();
 }
@@ -0,0 +1,64 @@
+#include <QElapsedTimer>
+#include <algorithm>
+#include "entrysearchprovider.h"
+#include "matchbenchmark.h"
+#include "taskscheduler.h"
+
+static const QStringList WORDS = {"fire", "term", "edit", "mail", "play", "view", "calc", "note",
+								  "chat", "draw", "scan", "sync", "code", "book", "map",  "wave"};
+
+/* From what is typed first to what matches nothing */
+static const QStringList QUERIES = {"e", "te", "fir", "note", "scanmap", "qsrunbenchnonexistent"};
+
+MatchBenchmark::MatchBenchmark() : out(stdout)
+{
+}
+
+EntryStorePtr MatchBenchmark::createCatalog(int entries)
+{
+	QVector<EntryConfig> systemEntries;
+	systemEntries.reserve(entries);
+	for(int i = 0; i < entries; i++)
+	{
+		EntryConfig config;
+		config.name = WORDS[i % WORDS.size()] + WORDS[(i / WORDS.size()) % WORDS.size()] + QString::number(i);
+		config.command = "/nix/store/" + QString::number(i, 16) + "-" + WORDS[(i / 7) % WORDS.size()] + "/bin/run";
+		systemEntries.append(config);
+	}
+	return EntryStorePtr(new EntryStore({}, systemEntries));
+}
+
+int MatchBenchmark::run()
+{
+	EntryStorePtr store = createCatalog(ENTRIES);
+	const int maxThreads = TaskScheduler::instance().workerCount();
+
+	this->out << "threads\tms per query\tmillion entries/s\tspeedup" << Qt::endl;
+	double baseline = 0;
+	for(int threads = 1; threads <= maxThreads; threads++)
+	{
+		/* Warm up, e. g. the workers and the allocator */
+		EntrySearchProvider::rankAll(store, QUERIES.first(), threads);
+
+		QElapsedTimer timer;
+		timer.start();
+		for(int i = 0; i < ITERATIONS; i++)
+		{
+			for(const QString &query : QUERIES)
+			{
+				EntrySearchProvider::rankAll(store, query, threads);
+			}
+		}
+		const double seconds = timer.nsecsElapsed() / 1e9;
+		const int queries = ITERATIONS * QUERIES.size();
+		const double throughput = static_cast<double>(store->size()) * queries / seconds / 1e6;
+		if(threads == 1)
+		{
+			baseline = throughput;
+		}
+		this->out << threads << "\t" << QString::number(seconds * 1000 / queries, 'f', 2) << "\t"
+				  << QString::number(throughput, 'f', 2) << "\t" << QString::number(throughput / baseline, 'f', 2)
+				  << Qt::endl;
+	}
+	return 0;
+}
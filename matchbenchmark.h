@@ -0,0 +1,23 @@
+#ifndef MATCHBENCHMARK_H
+#define MATCHBENCHMARK_H
+#include <QTextStream>
+#include "entrystore.h"
+
+/* Ranks scripted queries against a large synthetic catalog with an increasing number of
+ * workers and reports the throughput, to see how matching scales with cores. Headless */
+class MatchBenchmark
+{
+  private:
+	QTextStream out;
+
+	static EntryStorePtr createCatalog(int entries);
+
+  public:
+	static const int ENTRIES = 200000;
+	static const int ITERATIONS = 10;
+
+	MatchBenchmark();
+	int run();
+};
+
+#endif // MATCHBENCHMARK_H
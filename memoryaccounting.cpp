@@ -0,0 +1,354 @@
+#include <QFile>
+#include <QMutexLocker>
+#include <algorithm>
+#include <atomic>
+#include "memoryaccounting.h"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifdef QSRUN_ALLOCATION_COUNTING
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#endif
+
+#ifdef QSRUN_ALLOCATION_COUNTING
+#ifndef __GLIBC__
+#error "Allocation counting needs glibc"
+#endif
+
+static const char *TAG_NAMES[MemoryAccounting::TAG_COUNT] = {"other", "entries",	"search", "grid",
+															  "icons", "calculator", "history"};
+
+/* Nothing below may allocate, it runs inside malloc() */
+static thread_local int currentTag = MemoryAccounting::OTHER;
+static std::atomic<quint64> allocationCounts[MemoryAccounting::TAG_COUNT];
+static std::atomic<quint64> allocationBytes[MemoryAccounting::TAG_COUNT];
+static std::atomic<qint64> liveBytes[MemoryAccounting::TAG_COUNT];
+
+/* In front of every block we hand out, so free() knows what to subtract from which tag.
+ * base is what glibc returned, it may differ from the header's address for aligned blocks */
+struct AllocationHeader
+{
+	void *base;
+	quint64 size : 55;
+	quint64 aligned : 1;
+	quint64 tag : 8;
+};
+static_assert(sizeof(AllocationHeader) == 16, "The header must keep malloc()'s 16 byte alignment");
+
+static inline AllocationHeader *headerOf(void *ptr)
+{
+	return static_cast<AllocationHeader *>(ptr) - 1;
+}
+
+/* Writes the header in front of ptr and counts the block */
+static inline void *track(void *base, void *ptr, size_t size, bool aligned = false)
+{
+	AllocationHeader *header = headerOf(ptr);
+	header->base = base;
+	header->size = size;
+	header->aligned = aligned;
+	header->tag = currentTag;
+	allocationCounts[currentTag].fetch_add(1, std::memory_order_relaxed);
+	allocationBytes[currentTag].fetch_add(size, std::memory_order_relaxed);
+	liveBytes[currentTag].fetch_add(size, std::memory_order_relaxed);
+	return ptr;
+}
+
+static inline void untrack(AllocationHeader *header)
+{
+	liveBytes[header->tag].fetch_sub(header->size, std::memory_order_relaxed);
+}
+
+/* Interposes the allocator for the whole process (Qt, libqalculate and operator new included),
+ * glibc's implementation does the actual work. Every function glibc documents for replacing
+ * malloc is here, as the others would get or be handed blocks without our header */
+extern "C"
+{
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+	void __libc_free(void *ptr);
+
+	void *malloc(size_t size) __THROW
+	{
+		size_t total;
+		if(__builtin_add_overflow(size, sizeof(AllocationHeader), &total))
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+		void *base = __libc_malloc(total);
+		if(base == nullptr)
+		{
+			return nullptr;
+		}
+		return track(base, static_cast<AllocationHeader *>(base) + 1, size);
+	}
+
+	void free(void *ptr) __THROW
+	{
+		if(ptr == nullptr)
+		{
+			return;
+		}
+		AllocationHeader *header = headerOf(ptr);
+		untrack(header);
+		__libc_free(header->base);
+	}
+
+	void *calloc(size_t count, size_t size) __THROW
+	{
+		size_t bytes, total;
+		if(__builtin_mul_overflow(count, size, &bytes) ||
+		   __builtin_add_overflow(bytes, sizeof(AllocationHeader), &total))
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+		void *base = __libc_calloc(1, total);
+		if(base == nullptr)
+		{
+			return nullptr;
+		}
+		return track(base, static_cast<AllocationHeader *>(base) + 1, bytes);
+	}
+
+	/* Alignments up to 16 are what malloc() returns anyway */
+	void *memalign(size_t alignment, size_t size) __THROW
+	{
+		if(alignment <= alignof(AllocationHeader) * 2)
+		{
+			return malloc(size);
+		}
+		if((alignment & (alignment - 1)) != 0)
+		{
+			errno = EINVAL;
+			return nullptr;
+		}
+		size_t total;
+		if(__builtin_add_overflow(size, alignment + sizeof(AllocationHeader), &total))
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+		void *base = __libc_malloc(total);
+		if(base == nullptr)
+		{
+			return nullptr;
+		}
+		uintptr_t aligned = (reinterpret_cast<uintptr_t>(base) + sizeof(AllocationHeader) + alignment - 1) &
+							~(alignment - 1);
+		return track(base, reinterpret_cast<void *>(aligned), size, true);
+	}
+
+	void *realloc(void *ptr, size_t size) __THROW
+	{
+		if(ptr == nullptr)
+		{
+			return malloc(size);
+		}
+		if(size == 0)
+		{
+			free(ptr);
+			return nullptr;
+		}
+		AllocationHeader *header = headerOf(ptr);
+		/* Moving an aligned block could lose the alignment, so copy those */
+		if(header->aligned)
+		{
+			void *result = malloc(size);
+			if(result != nullptr)
+			{
+				memcpy(result, ptr, std::min<size_t>(size, header->size));
+				free(ptr);
+			}
+			return result;
+		}
+		size_t total;
+		if(__builtin_add_overflow(size, sizeof(AllocationHeader), &total))
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+		AllocationHeader old = *header;
+		void *base = __libc_realloc(header, total);
+		if(base == nullptr)
+		{
+			return nullptr;
+		}
+		untrack(&old);
+		return track(base, static_cast<AllocationHeader *>(base) + 1, size);
+	}
+
+	int posix_memalign(void **result, size_t alignment, size_t size) __THROW
+	{
+		if(alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+		{
+			return EINVAL;
+		}
+		void *ptr = memalign(alignment, size);
+		if(ptr == nullptr)
+		{
+			return ENOMEM;
+		}
+		*result = ptr;
+		return 0;
+	}
+
+	void *aligned_alloc(size_t alignment, size_t size) __THROW
+	{
+		return memalign(alignment, size);
+	}
+
+	void *valloc(size_t size) __THROW
+	{
+		return memalign(getpagesize(), size);
+	}
+
+	void *pvalloc(size_t size) __THROW
+	{
+		size_t pageSize = getpagesize();
+		size_t rounded;
+		if(__builtin_add_overflow(size, pageSize - 1, &rounded))
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+		return memalign(pageSize, rounded & ~(pageSize - 1));
+	}
+
+	/* What was asked for, the slack glibc may have added is not ours to hand out */
+	size_t malloc_usable_size(void *ptr) __THROW
+	{
+		return ptr == nullptr ? 0 : headerOf(ptr)->size;
+	}
+}
+
+AllocationScope::AllocationScope(MemoryAccounting::Tag tag) : previous(currentTag)
+{
+	currentTag = tag;
+}
+
+AllocationScope::~AllocationScope()
+{
+	currentTag = this->previous;
+}
+#endif
+
+MemoryAccounting &MemoryAccounting::instance()
+{
+	static MemoryAccounting accounting;
+	return accounting;
+}
+
+bool MemoryAccounting::allocationCountingEnabled()
+{
+#ifdef QSRUN_ALLOCATION_COUNTING
+	return true;
+#else
+	return false;
+#endif
+}
+
+qint64 MemoryAccounting::stringBytes(const QString &str)
+{
+	if(str.isNull())
+	{
+		return 0;
+	}
+	return sizeof(QArrayData) + (str.capacity() + 1) * sizeof(QChar);
+}
+
+MemoryAccounting::Totals MemoryAccounting::totals()
+{
+	Totals result;
+#ifdef QSRUN_ALLOCATION_COUNTING
+	for(int i = 0; i < TAG_COUNT; i++)
+	{
+		result.count += allocationCounts[i].load(std::memory_order_relaxed);
+		result.bytes += allocationBytes[i].load(std::memory_order_relaxed);
+	}
+#endif
+	return result;
+}
+
+void MemoryAccounting::keystroke()
+{
+	if(!allocationCountingEnabled())
+	{
+		return;
+	}
+	Totals now = totals();
+	QMutexLocker locker(&this->mutex);
+	if(this->keystrokes > 0)
+	{
+		this->lastKeystroke.count = now.count - this->keystrokeStart.count;
+		this->lastKeystroke.bytes = now.bytes - this->keystrokeStart.bytes;
+		this->maxKeystroke.count = std::max(this->maxKeystroke.count, this->lastKeystroke.count);
+		this->maxKeystroke.bytes = std::max(this->maxKeystroke.bytes, this->lastKeystroke.bytes);
+	}
+	this->keystrokeStart = now;
+	++this->keystrokes;
+}
+
+QJsonObject MemoryAccounting::toJson(const Totals &totals)
+{
+	return {{"count", static_cast<qint64>(totals.count)}, {"bytes", static_cast<qint64>(totals.bytes)}};
+}
+
+QJsonObject MemoryAccounting::toJson() const
+{
+	QJsonObject process;
+	QFile status("/proc/self/status");
+	if(status.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		for(const QByteArray &line : status.readAll().split('\n'))
+		{
+			/* e. g. "VmRSS:	   12345 kB" */
+			for(const char *field : {"VmRSS", "VmHWM", "RssAnon", "RssFile"})
+			{
+				if(line.startsWith(QByteArray(field) + ":"))
+				{
+					QByteArray value = line.mid(qstrlen(field) + 1).trimmed();
+					process[QString(field).toLower() + "_bytes"] = value.split(' ').first().toLongLong() * 1024;
+				}
+			}
+		}
+	}
+
+	QJsonObject result;
+	result["process"] = process;
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 info = mallinfo2();
+	result["heap"] = QJsonObject{{"in_use_bytes", static_cast<qint64>(info.uordblks)},
+								 {"free_bytes", static_cast<qint64>(info.fordblks)},
+								 {"mmapped_bytes", static_cast<qint64>(info.hblkhd)}};
+#endif
+#endif
+
+	QJsonObject allocations;
+	allocations["enabled"] = allocationCountingEnabled();
+#ifdef QSRUN_ALLOCATION_COUNTING
+	QJsonObject byTag;
+	for(int i = 0; i < TAG_COUNT; i++)
+	{
+		Totals totals;
+		totals.count = allocationCounts[i].load(std::memory_order_relaxed);
+		totals.bytes = allocationBytes[i].load(std::memory_order_relaxed);
+		QJsonObject tag = toJson(totals);
+		tag["live_bytes"] = static_cast<qint64>(liveBytes[i].load(std::memory_order_relaxed));
+		byTag[TAG_NAMES[i]] = tag;
+	}
+	allocations["by_tag"] = byTag;
+	allocations["total"] = toJson(totals());
+	QMutexLocker locker(&this->mutex);
+	allocations["keystrokes"] = static_cast<qint64>(this->keystrokes);
+	allocations["last_keystroke"] = toJson(this->lastKeystroke);
+	allocations["max_keystroke"] = toJson(this->maxKeystroke);
+#endif
+	result["allocations"] = allocations;
+	return result;
+}
@@ -0,0 +1,74 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+
+/* Where qsrun's memory goes, dumped on demand (/memory).
+ *
+ * Subsystems report what they hold themselves, see their memoryReport(). Built with
+ * CONFIG+=allocation_counting, every heap allocation is counted too: by the AllocationScope
+ * tag of the allocating thread, and between keystrokes. Blocks carry their tag in a 16 byte
+ * header, so what is still alive per tag is known as well. That costs the header and a few
+ * atomic operations per allocation, hence it is off by default */
+class MemoryAccounting
+{
+  public:
+	enum Tag
+	{
+		OTHER,
+		ENTRIES,
+		SEARCH,
+		GRID,
+		ICONS,
+		CALCULATOR,
+		HISTORY,
+		TAG_COUNT
+	};
+
+  private:
+	struct Totals
+	{
+		quint64 count = 0;
+		quint64 bytes = 0;
+	};
+
+	mutable QMutex mutex;
+	quint64 keystrokes = 0;
+	Totals keystrokeStart;
+	Totals lastKeystroke;
+	Totals maxKeystroke;
+
+	static Totals totals();
+	static QJsonObject toJson(const Totals &totals);
+
+  public:
+	static MemoryAccounting &instance();
+	static bool allocationCountingEnabled();
+	/* Rough heap size of str, shared data is counted fully */
+	static qint64 stringBytes(const QString &str);
+	/* Allocations until the next call are attributed to this keystroke */
+	void keystroke();
+	/* Process, heap and allocation numbers */
+	QJsonObject toJson() const;
+};
+
+/* Attributes the allocations of the current thread to tag while in scope */
+class AllocationScope
+{
+#ifdef QSRUN_ALLOCATION_COUNTING
+  private:
+	int previous;
+
+  public:
+	explicit AllocationScope(MemoryAccounting::Tag tag);
+	~AllocationScope();
+#else
+  public:
+	explicit AllocationScope(MemoryAccounting::Tag)
+	{
+	}
+#endif
+};
+
+#endif // MEMORYACCOUNTING_H
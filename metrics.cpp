@@ -0,0 +1,37 @@
+#include <QMutexLocker>
+#include "metrics.h"
+
+Metrics &Metrics::instance()
+{
+	static Metrics metrics;
+	return metrics;
+}
+
+void Metrics::add(const QString &name, qint64 delta)
+{
+	QMutexLocker locker(&this->mutex);
+	this->values[name] += delta;
+}
+
+void Metrics::set(const QString &name, qint64 value)
+{
+	QMutexLocker locker(&this->mutex);
+	this->values[name] = value;
+}
+
+qint64 Metrics::value(const QString &name) const
+{
+	QMutexLocker locker(&this->mutex);
+	return this->values.value(name);
+}
+
+QJsonObject Metrics::toJson() const
+{
+	QMutexLocker locker(&this->mutex);
+	QJsonObject result;
+	for(auto it = this->values.constBegin(); it != this->values.constEnd(); ++it)
+	{
+		result[it.key()] = it.value();
+	}
+	return result;
+}
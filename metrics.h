@@ -0,0 +1,23 @@
+#ifndef METRICS_H
+#define METRICS_H
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+/* Process wide named counters, can be dumped on demand (/metrics) */
+class Metrics
+{
+  private:
+	mutable QMutex mutex;
+	QMap<QString, qint64> values;
+
+  public:
+	static Metrics &instance();
+	void add(const QString &name, qint64 delta = 1);
+	void set(const QString &name, qint64 value);
+	qint64 value(const QString &name) const;
+	QJsonObject toJson() const;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,63 @@
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QProcessEnvironment>
+#include "pathsearchprovider.h"
+
+QStringList PathSearchProvider::generatePATHSuggestions(const QString &text, const CancellationToken &token)
+{
+	QStringList results;
+	QString pathVar = QProcessEnvironment::systemEnvironment().value("PATH", "/usr/bin/:/bin/:");
+	QStringList paths = pathVar.split(":");
+	for(const QString &path : paths)
+	{
+		QDirIterator it(path);
+		while(it.hasNext())
+		{
+			if(token.isCancelled())
+			{
+				return {};
+			}
+			QFileInfo info(it.next());
+			if(info.isFile() && info.isExecutable())
+			{
+				QString entry = info.baseName();
+				if(entry.startsWith(text))
+				{
+					results.append(entry);
+				}
+			}
+		}
+	}
+	return results;
+}
+
+QString PathSearchProvider::name() const
+{
+	return "PATH";
+}
+
+int PathSearchProvider::tier() const
+{
+	return 1;
+}
+
+int PathSearchProvider::latencyBudget() const
+{
+	return 500;
+}
+
+void PathSearchProvider::search(const QString &query, const CancellationToken &token,
+								const SearchResultCallback &emitResults)
+{
+	QStringList suggestions = generatePATHSuggestions(query, token);
+	if(suggestions.length() == 1)
+	{
+		EntryConfig e;
+		e.name = suggestions[0];
+		e.command = suggestions[0];
+		e.commandLine = suggestions[0];
+		e.iconPath = suggestions[0];
+		e.type = EntryType::DYNAMIC;
+		emitResults(detachedResults({e}, {0}));
+	}
+}
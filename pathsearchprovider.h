@@ -0,0 +1,19 @@
+#ifndef PATHSEARCHPROVIDER_H
+#define PATHSEARCHPROVIDER_H
+#include <QStringList>
+#include "searchprovider.h"
+
+/* Suggests an executable from PATH if exactly one matches */
+class PathSearchProvider : public SearchProvider
+{
+  public:
+	static QStringList generatePATHSuggestions(const QString &text, const CancellationToken &token = {});
+
+	QString name() const override;
+	int tier() const override;
+	int latencyBudget() const override;
+	void search(const QString &query, const CancellationToken &token,
+				const SearchResultCallback &emitResults) override;
+};
+
+#endif // PATHSEARCHPROVIDER_H
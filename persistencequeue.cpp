@@ -0,0 +1,134 @@
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSet>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "persistencequeue.h"
+#include "stallwatchdog.h"
+
+/* Gives rapid successive changes (e.g. rearranging favourites) the chance to end up in the same batch */
+static const int COALESCE_MSECS = 200;
+
+PersistenceQueue::PersistenceQueue(QObject *parent) : QObject(parent)
+{
+	this->worker = QThread::create([this] { run(); });
+	this->worker->start(QThread::LowPriority);
+}
+
+PersistenceQueue::~PersistenceQueue()
+{
+	{
+		QMutexLocker locker(&this->mutex);
+		this->stopping = true;
+		this->workAvailable.wakeAll();
+	}
+	this->worker->wait();
+	delete this->worker;
+}
+
+void PersistenceQueue::enqueue(const QString &path, const QByteArray &content)
+{
+	QMutexLocker locker(&this->mutex);
+	this->pending[path] = content;
+	this->workAvailable.wakeAll();
+}
+
+void PersistenceQueue::flush()
+{
+	PhaseScope phase("waiting for saves");
+	QMutexLocker locker(&this->mutex);
+	this->flushRequested = true;
+	this->workAvailable.wakeAll();
+	while(!this->pending.isEmpty() || this->writing)
+	{
+		this->idle.wait(&this->mutex);
+	}
+	this->flushRequested = false;
+}
+
+void PersistenceQueue::run()
+{
+	QMutexLocker locker(&this->mutex);
+	while(true)
+	{
+		while(this->pending.isEmpty() && !this->stopping)
+		{
+			this->workAvailable.wait(&this->mutex);
+		}
+		if(this->pending.isEmpty())
+		{
+			/* stopping, and everything has been written */
+			return;
+		}
+		QDeadlineTimer deadline(COALESCE_MSECS);
+		while(!this->stopping && !this->flushRequested && !deadline.hasExpired())
+		{
+			this->workAvailable.wait(&this->mutex, deadline);
+		}
+		QHash<QString, QByteArray> batch;
+		batch.swap(this->pending);
+		this->writing = true;
+
+		locker.unlock();
+		writeBatch(batch);
+		locker.relock();
+
+		this->writing = false;
+		if(this->pending.isEmpty())
+		{
+			this->idle.wakeAll();
+		}
+	}
+}
+
+void PersistenceQueue::writeBatch(const QHash<QString, QByteArray> &batch)
+{
+	QStringList written;
+	for(auto it = batch.constBegin(); it != batch.constEnd(); ++it)
+	{
+		QFile file{it.key() + ".transit"};
+		if(!file.open(QIODevice::WriteOnly))
+		{
+			emit saveFailed(it.key(), "Can not open file for writing: " + file.errorString());
+			continue;
+		}
+		if(file.write(it.value()) != it.value().size() || !file.flush() || fsync(file.handle()) != 0)
+		{
+			emit saveFailed(it.key(), "Failed to write file: " + file.errorString());
+			file.remove();
+			continue;
+		}
+		file.close();
+		written.append(it.key());
+	}
+
+	QSet<QString> directories;
+	for(const QString &path : written)
+	{
+		QString transitPath = path + ".transit";
+		if(rename(QFile::encodeName(transitPath).constData(), QFile::encodeName(path).constData()) != 0)
+		{
+			emit saveFailed(path, QString("Error during rename: ") + strerror(errno));
+			continue;
+		}
+		directories.insert(QFileInfo(path).absolutePath());
+	}
+
+	/* Makes the renames durable. Without, they may be lost on a crash, so that is a failure too */
+	for(const QString &directory : directories)
+	{
+		int fd = open(QFile::encodeName(directory).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(fd == -1 || fsync(fd) != 0)
+		{
+			emit saveFailed(directory, QString("Failed to sync directory: ") + strerror(errno));
+		}
+		if(fd != -1)
+		{
+			close(fd);
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef PERSISTENCEQUEUE_H
+#define PERSISTENCEQUEUE_H
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+/* Writes files in the background, so slow disks never stall the GUI. Writes to the same path
+ * are coalesced, only the latest content is written. Each file is written to a transit file and renamed,
+ * fsyncs of the files and their directories are done once per batch. */
+class PersistenceQueue : public QObject
+{
+	Q_OBJECT
+  private:
+	QMutex mutex;
+	QWaitCondition workAvailable;
+	QWaitCondition idle;
+	QHash<QString, QByteArray> pending;
+	bool writing = false;
+	bool flushRequested = false;
+	bool stopping = false;
+	QThread *worker = nullptr;
+
+	void run();
+	void writeBatch(const QHash<QString, QByteArray> &batch);
+
+  public:
+	PersistenceQueue(QObject *parent = nullptr);
+	~PersistenceQueue();
+	void enqueue(const QString &path, const QByteArray &content);
+	/* Blocks until everything enqueued so far is on disk */
+	void flush();
+
+  signals:
+	void saveFailed(const QString &path, const QString &error);
+};
+
+#endif // PERSISTENCEQUEUE_H
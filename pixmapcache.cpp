@@ -0,0 +1,336 @@
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QIcon>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+#include "metrics.h"
+#include "pixmapcache.h"
+
+static const quint32 CACHE_FILE_MAGIC = 0x71737470; // "qstp"
+static const quint32 CACHE_FILE_VERSION = 1;
+static const QImage::Format CACHE_IMAGE_FORMAT = QImage::Format_ARGB32_Premultiplied;
+
+struct PixmapCache::Header
+{
+	quint32 magic;
+	quint32 version;
+	quint32 count;
+	quint32 reserved;
+	quint64 dataOffset;
+};
+
+struct PixmapCache::Record
+{
+	quint64 key;
+	qint64 lastUsed;
+	quint64 offset;
+	quint32 width;
+	quint32 height;
+};
+
+struct PixmapCache::Mapping
+{
+	QFile file;
+	const uchar *data = nullptr;
+	qint64 size = 0;
+
+	~Mapping()
+	{
+		if(this->data != nullptr)
+		{
+			this->file.unmap(const_cast<uchar *>(this->data));
+		}
+	}
+
+	const Record *records() const
+	{
+		return reinterpret_cast<const Record *>(this->data + sizeof(Header));
+	}
+
+	QImage image(int position) const
+	{
+		const Record &record = records()[position];
+		/* A deep copy, the pixmap must not depend on the mapping */
+		QImage result(record.width, record.height, CACHE_IMAGE_FORMAT);
+		const uchar *source = this->data + record.offset;
+		const int lineBytes = record.width * 4;
+		for(quint32 y = 0; y < record.height; y++)
+		{
+			std::memcpy(result.scanLine(y), source + y * lineBytes, lineBytes);
+		}
+		return result;
+	}
+};
+
+PixmapCache &PixmapCache::instance()
+{
+	static PixmapCache cache;
+	return cache;
+}
+
+QString PixmapCache::cacheFilePath()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pixmaps.cache";
+}
+
+quint64 PixmapCache::key(const QString &sourcePath, int size, qreal devicePixelRatio)
+{
+	QFileInfo info(sourcePath);
+	QByteArray description = sourcePath.toUtf8() + '\n' +
+							 QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + '\n' +
+							 QByteArray::number(size) + '\n' + QByteArray::number(devicePixelRatio);
+	QByteArray hash = QCryptographicHash::hash(description, QCryptographicHash::Sha1);
+	quint64 result;
+	std::memcpy(&result, hash.constData(), sizeof(result));
+	return result;
+}
+
+void PixmapCache::openUnlocked()
+{
+	this->mapping.reset();
+	this->mapped.clear();
+	QSharedPointer<Mapping> newMapping(new Mapping());
+	newMapping->file.setFileName(cacheFilePath());
+	if(!newMapping->file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+	qint64 newSize = newMapping->file.size();
+	if(newSize < static_cast<qint64>(sizeof(Header)))
+	{
+		return;
+	}
+	newMapping->data = newMapping->file.map(0, newSize);
+	if(newMapping->data == nullptr)
+	{
+		return;
+	}
+	newMapping->size = newSize;
+	const Header *header = reinterpret_cast<const Header *>(newMapping->data);
+	if(header->magic != CACHE_FILE_MAGIC || header->version != CACHE_FILE_VERSION ||
+	   sizeof(Header) + header->count * sizeof(Record) > static_cast<quint64>(newSize))
+	{
+		qDebug() << "Ignoring pixmap cache of unknown format";
+		return;
+	}
+	this->mapping = newMapping;
+	const Record *table = this->mapping->records();
+	for(quint32 i = 0; i < header->count; i++)
+	{
+		const Record &record = table[i];
+		if(record.offset + quint64(record.width) * record.height * 4 > static_cast<quint64>(newSize))
+		{
+			continue;
+		}
+		this->mapped[record.key] = i;
+		if(!this->lastUsed.contains(record.key))
+		{
+			this->lastUsed[record.key] = record.lastUsed;
+		}
+	}
+}
+
+QPixmap PixmapCache::pixmap(const QString &sourcePath, int size, qreal devicePixelRatio)
+{
+	quint64 entryKey = key(sourcePath, size, devicePixelRatio);
+	QImage image;
+	{
+		QMutexLocker locker(&this->mutex);
+		if(!this->opened)
+		{
+			openUnlocked();
+			this->opened = true;
+		}
+		auto addedIt = this->added.constFind(entryKey);
+		if(addedIt != this->added.constEnd())
+		{
+			image = addedIt.value();
+		}
+		else
+		{
+			auto mappedIt = this->mapped.constFind(entryKey);
+			if(mappedIt != this->mapped.constEnd())
+			{
+				image = this->mapping->image(mappedIt.value());
+			}
+		}
+		if(!image.isNull())
+		{
+			this->lastUsed[entryKey] = QDateTime::currentSecsSinceEpoch();
+		}
+	}
+	if(!image.isNull())
+	{
+		Metrics::instance().add("pixmapcache.hits");
+		image.setDevicePixelRatio(devicePixelRatio);
+		return QPixmap::fromImage(std::move(image));
+	}
+
+	Metrics::instance().add("pixmapcache.misses");
+	const int pixelSize = qRound(size * devicePixelRatio);
+	image = QIcon(sourcePath).pixmap(QSize(pixelSize, pixelSize)).toImage().convertToFormat(CACHE_IMAGE_FORMAT);
+	if(image.isNull())
+	{
+		return QPixmap();
+	}
+	{
+		QMutexLocker locker(&this->mutex);
+		this->added[entryKey] = image;
+		this->lastUsed[entryKey] = QDateTime::currentSecsSinceEpoch();
+		this->dirty = true;
+	}
+	image.setDevicePixelRatio(devicePixelRatio);
+	return QPixmap::fromImage(std::move(image));
+}
+
+void PixmapCache::save()
+{
+	QMutexLocker saveLocker(&this->saveMutex);
+	QHash<quint64, QImage> added;
+	QHash<quint64, int> mapped;
+	QHash<quint64, qint64> lastUsed;
+	QSharedPointer<Mapping> mapping;
+	{
+		QMutexLocker locker(&this->mutex);
+		if(!this->dirty)
+		{
+			return;
+		}
+		/* All implicitly shared or small, the mapping stays alive as long as we hold on to it */
+		added = this->added;
+		mapped = this->mapped;
+		lastUsed = this->lastUsed;
+		mapping = this->mapping;
+	}
+
+	/* Most recently used first, whatever does not fit anymore is evicted */
+	QVector<quint64> keys;
+	keys.reserve(added.size() + mapped.size());
+	for(auto it = added.constBegin(); it != added.constEnd(); ++it)
+	{
+		keys.append(it.key());
+	}
+	for(auto it = mapped.constBegin(); it != mapped.constEnd(); ++it)
+	{
+		if(!added.contains(it.key()))
+		{
+			keys.append(it.key());
+		}
+	}
+	std::sort(keys.begin(), keys.end(),
+			  [&lastUsed](quint64 a, quint64 b) { return lastUsed.value(a) > lastUsed.value(b); });
+
+	QVector<Record> table;
+	quint64 pixelBytes = 0;
+	for(quint64 entryKey : keys)
+	{
+		quint32 width, height;
+		auto addedIt = added.constFind(entryKey);
+		if(addedIt != added.constEnd())
+		{
+			width = addedIt.value().width();
+			height = addedIt.value().height();
+		}
+		else
+		{
+			const Record &record = mapping->records()[mapped[entryKey]];
+			width = record.width;
+			height = record.height;
+		}
+		quint64 bytes = quint64(width) * height * 4;
+		if(pixelBytes + bytes > static_cast<quint64>(MAX_CACHE_BYTES))
+		{
+			break;
+		}
+		table.append({entryKey, lastUsed.value(entryKey), pixelBytes, width, height});
+		pixelBytes += bytes;
+	}
+
+	Header header;
+	header.magic = CACHE_FILE_MAGIC;
+	header.version = CACHE_FILE_VERSION;
+	header.count = table.size();
+	header.reserved = 0;
+	/* Keep the pixel data 16 byte aligned */
+	header.dataOffset = (sizeof(Header) + table.size() * sizeof(Record) + 15) & ~quint64(15);
+	for(Record &record : table)
+	{
+		record.offset += header.dataOffset;
+	}
+
+	QString path = cacheFilePath();
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	QSaveFile out(path);
+	if(!out.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(table.constData()), table.size() * sizeof(Record));
+	out.write(QByteArray(header.dataOffset - sizeof(Header) - table.size() * sizeof(Record), '\0'));
+	for(const Record &record : table)
+	{
+		const int lineBytes = record.width * 4;
+		auto addedIt = added.constFind(record.key);
+		if(addedIt != added.constEnd())
+		{
+			for(quint32 y = 0; y < record.height; y++)
+			{
+				out.write(reinterpret_cast<const char *>(addedIt.value().constScanLine(y)), lineBytes);
+			}
+		}
+		else
+		{
+			const Record &source = mapping->records()[mapped[record.key]];
+			out.write(reinterpret_cast<const char *>(mapping->data + source.offset), qint64(lineBytes) * record.height);
+		}
+	}
+	if(!out.commit())
+	{
+		qDebug() << "Failed to save pixmap cache: " << out.errorString();
+		return;
+	}
+
+	/* The rendered images are in the file now, map it instead of keeping them around.
+	 * Only those of the snapshot, others may have been rendered in the meantime */
+	QMutexLocker locker(&this->mutex);
+	for(auto it = added.constBegin(); it != added.constEnd(); ++it)
+	{
+		this->added.remove(it.key());
+	}
+	/* Evicted entries, and those of changed files, are gone for good, so are their times. Keep the
+	 * times of what was written and of what was rendered since, the latest ones if used meanwhile */
+	QHash<quint64, qint64> stillUsed;
+	stillUsed.reserve(table.size() + this->added.size());
+	for(const Record &record : table)
+	{
+		stillUsed[record.key] = this->lastUsed.value(record.key, record.lastUsed);
+	}
+	for(auto it = this->added.constBegin(); it != this->added.constEnd(); ++it)
+	{
+		stillUsed[it.key()] = this->lastUsed.value(it.key());
+	}
+	this->lastUsed.swap(stillUsed);
+	openUnlocked();
+	this->dirty = !this->added.isEmpty();
+}
+
+QJsonObject PixmapCache::memoryReport() const
+{
+	QMutexLocker locker(&this->mutex);
+	qint64 renderedBytes = 0;
+	for(const QImage &image : this->added)
+	{
+		renderedBytes += image.sizeInBytes();
+	}
+	return {{"mapped_pixmaps", this->mapped.size()},
+			{"mapped_bytes", this->mapping.isNull() ? 0 : this->mapping->size},
+			{"rendered_pixmaps", this->added.size()},
+			{"rendered_bytes", renderedBytes},
+			{"usage_times", this->lastUsed.size()}};
+}
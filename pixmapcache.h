@@ -0,0 +1,56 @@
+#ifndef PIXMAPCACHE_H
+#define PIXMAPCACHE_H
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPixmap>
+#include <QSharedPointer>
+
+/* Rendered icon pixmaps that survive restarts, so icons (especially SVGs) do not need to be
+ * decoded and rasterized again on every start.
+ *
+ * Entries are addressed by source path, its mtime, the size and the device pixel ratio, hence
+ * changed files are never served stale, their old entries simply age out. The raw pixels live
+ * in a single file which is memory-mapped. Pixmaps rendered during this run are kept in memory
+ * until save() writes a new file, evicting the least recently used entries above the size limit. */
+class PixmapCache
+{
+  private:
+	struct Header;
+	struct Record;
+	/* The mapped file, shared with save() while it copies from it */
+	struct Mapping;
+
+	mutable QMutex mutex;
+	/* Only one save() at a time, the mutex is not held while writing */
+	QMutex saveMutex;
+	QSharedPointer<Mapping> mapping;
+	/* Position of every mapped entry in the record table */
+	QHash<quint64, int> mapped;
+	QHash<quint64, QImage> added;
+	/* Only updated in memory, it goes into the file along with the next new pixmaps */
+	QHash<quint64, qint64> lastUsed;
+	bool opened = false;
+	/* New pixmaps were rendered since the file was written */
+	bool dirty = false;
+
+	static QString cacheFilePath();
+	static quint64 key(const QString &sourcePath, int size, qreal devicePixelRatio);
+	void openUnlocked();
+
+  public:
+	static const qint64 MAX_CACHE_BYTES = 64 * 1024 * 1024;
+
+	static PixmapCache &instance();
+	/* The icon at sourcePath rendered at size (in device independent pixels), from the cache if possible */
+	QPixmap pixmap(const QString &sourcePath, int size, qreal devicePixelRatio);
+	/* Writes the cache file if pixmaps were rendered since it was opened. Takes a snapshot,
+	 * pixmap() is not held up while the file is written */
+	void save();
+	/* Mapped and rendered pixmaps */
+	QJsonObject memoryReport() const;
+};
+
+#endif // PIXMAPCACHE_H
@@ -1,27 +1,11 @@
-######################################################################
-# Automatically generated by qmake (3.0) Mon Dec 25 15:21:45 2017
-######################################################################
+# qsrun and its calculator plugin. Build without the calculator
+# (and thus without libqalculate) with: qmake CONFIG+=no_calculator
 
-TEMPLATE = app
-TARGET = qsrun
-INCLUDEPATH += .
+TEMPLATE = subdirs
 
-# Input
-HEADERS += calculationengine.h \
-           entryprovider.h \
-           entrypushbutton.h \
-           settingsprovider.h \
-           singleinstanceserver.h \
-           window.h
-SOURCES += calculationengine.cpp \
-           entryprovider.cpp \
-           entrypushbutton.cpp \
-           main.cpp \
-           settingsprovider.cpp \
-           singleinstanceserver.cpp \
-           window.cpp
-QT += widgets sql network
-QT_CONFIG -= no-pkg-config
-LIBS += -lcln
-CONFIG += link_pkgconfig c++17
-PKGCONFIG += libqalculate
+SUBDIRS = app
+app.file = app.pro
+
+!no_calculator {
+    SUBDIRS += calculator
+}
@@ -0,0 +1,166 @@
+#include <QDebug>
+#include <QTimer>
+#include <algorithm>
+#include "memoryaccounting.h"
+#include "searchdispatcher.h"
+
+SearchDispatcher::SearchDispatcher(QObject *parent) : QObject(parent)
+{
+}
+
+SearchDispatcher::~SearchDispatcher()
+{
+	cancel();
+	tasks.wait();
+}
+
+void SearchDispatcher::addProvider(QSharedPointer<SearchProvider> provider)
+{
+	this->providers.append(provider);
+	this->states.append(ProviderState());
+}
+
+void SearchDispatcher::removeProvider(QSharedPointer<SearchProvider> provider)
+{
+	int index = this->providers.indexOf(provider);
+	if(index < 0)
+	{
+		return;
+	}
+	cancel();
+	this->providers.removeAt(index);
+	this->states.removeAt(index);
+}
+
+void SearchDispatcher::cancel()
+{
+	this->currentToken.cancel();
+	this->currentToken = CancellationToken();
+	++this->generation;
+	this->publishedTier = -1;
+	for(ProviderState &state : this->states)
+	{
+		state.finished = true;
+		state.results.clear();
+		state.published = 0;
+	}
+}
+
+bool SearchDispatcher::isIdle() const
+{
+	return std::all_of(states.begin(), states.end(), [](const ProviderState &state) { return state.finished; });
+}
+
+void SearchDispatcher::search(const QString &query)
+{
+	cancel();
+	const quint64 currentGeneration = this->generation;
+	for(int i = 0; i < providers.size(); i++)
+	{
+		QSharedPointer<SearchProvider> provider = providers[i];
+		if(!provider->handles(query))
+		{
+			continue;
+		}
+		states[i].finished = false;
+		CancellationToken token = this->currentToken.withDeadline(provider->latencyBudget());
+		auto task = [this, provider, query, token, currentGeneration, i] {
+			AllocationScope allocations(MemoryAccounting::SEARCH);
+			provider->search(query, token, [this, currentGeneration, i](QVector<SearchResult> results) {
+				QMetaObject::invokeMethod(
+					this, [this, currentGeneration, i, results] { handleResults(currentGeneration, i, results); },
+					Qt::QueuedConnection);
+			});
+			QMetaObject::invokeMethod(
+				this, [this, currentGeneration, i] { handleFinished(currentGeneration, i); }, Qt::QueuedConnection);
+		};
+		TaskScheduler::instance().schedule(TaskScheduler::INTERACTIVE, task, token, &this->tasks);
+		QTimer::singleShot(provider->latencyBudget(), this, [this, currentGeneration, i] {
+			if(currentGeneration == this->generation && !states[i].finished)
+			{
+				qDebug() << providers[i]->name() << "exceeded its latency budget, ignoring further results";
+				handleFinished(currentGeneration, i);
+			}
+		});
+	}
+	publish();
+}
+
+void SearchDispatcher::handleResults(quint64 generation, int provider, const QVector<SearchResult> &results)
+{
+	ProviderState &state = this->states[provider];
+	if(generation != this->generation || state.finished)
+	{
+		return;
+	}
+	state.results.append(results);
+	publish();
+}
+
+void SearchDispatcher::handleFinished(quint64 generation, int provider)
+{
+	ProviderState &state = this->states[provider];
+	if(generation != this->generation || state.finished)
+	{
+		return;
+	}
+	state.finished = true;
+	publish();
+}
+
+void SearchDispatcher::publish()
+{
+	QVector<int> tiers;
+	for(const QSharedPointer<SearchProvider> &provider : providers)
+	{
+		if(!tiers.contains(provider->tier()))
+		{
+			tiers.append(provider->tier());
+		}
+	}
+	std::sort(tiers.begin(), tiers.end());
+
+	/* Show the first tier that has results. As long as a lower tier is still running and
+	 * has nothing yet, keep showing what is there, as we don't know whether it will have something */
+	for(int tier : tiers)
+	{
+		bool hasResults = false;
+		bool tierFinished = true;
+		for(int i = 0; i < providers.size(); i++)
+		{
+			if(providers[i]->tier() == tier)
+			{
+				hasResults = hasResults || !states[i].results.isEmpty();
+				tierFinished = tierFinished && states[i].finished;
+			}
+		}
+		if(hasResults)
+		{
+			/* Of the tier that is shown already, only what is new */
+			const bool append = tier == this->publishedTier;
+			QVector<SearchResult> results;
+			for(int i = 0; i < providers.size(); i++)
+			{
+				if(providers[i]->tier() == tier)
+				{
+					results.append(states[i].results.mid(append ? states[i].published : 0));
+					states[i].published = states[i].results.size();
+				}
+			}
+			this->publishedTier = tier;
+			if(!append || !results.isEmpty())
+			{
+				emit resultsChanged(results, append);
+			}
+			return;
+		}
+		if(!tierFinished)
+		{
+			return;
+		}
+	}
+	if(isIdle())
+	{
+		emit resultsChanged({}, false);
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef SEARCHDISPATCHER_H
+#define SEARCHDISPATCHER_H
+#include <QObject>
+#include <QSharedPointer>
+#include <QVector>
+#include "cancellationtoken.h"
+#include "searchprovider.h"
+#include "taskscheduler.h"
+
+/* Runs all providers concurrently for a query and collects their (partial) results.
+ * Whenever something new can be shown, resultsChanged() is emitted on the GUI thread, so fast
+ * providers are never held back by slow ones. Results are passed on as they come, ordering them
+ * by score is left to the receiver, which only needs to do so for what it actually shows */
+class SearchDispatcher : public QObject
+{
+	Q_OBJECT
+  private:
+	class ProviderState
+	{
+	  public:
+		bool finished = true;
+		QVector<SearchResult> results;
+		/* How many of the results have been emitted */
+		int published = 0;
+	};
+	QVector<QSharedPointer<SearchProvider>> providers;
+	QVector<ProviderState> states;
+	quint64 generation = 0;
+	/* The tier whose results were emitted last for this query, -1 if none */
+	int publishedTier = -1;
+	CancellationToken currentToken;
+	/* Declared last so that it is destroyed first, waiting for running searches */
+	TaskGroup tasks;
+
+	void handleResults(quint64 generation, int provider, const QVector<SearchResult> &results);
+	void handleFinished(quint64 generation, int provider);
+	void publish();
+
+  public:
+	SearchDispatcher(QObject *parent = nullptr);
+	~SearchDispatcher();
+	void addProvider(QSharedPointer<SearchProvider> provider);
+	/* Cancels the current search, its results would be mixed up otherwise */
+	void removeProvider(QSharedPointer<SearchProvider> provider);
+	void search(const QString &query);
+	void cancel();
+	bool isIdle() const;
+
+  signals:
+	/* With append, results are to be added to the ones emitted before, otherwise they replace them */
+	void resultsChanged(const QVector<SearchResult> &results, bool append);
+};
+
+#endif // SEARCHDISPATCHER_H
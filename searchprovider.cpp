@@ -0,0 +1,59 @@
+#include "searchprovider.h"
+
+const EntryConfig &SearchResult::entry() const
+{
+	static const EntryConfig none;
+	return this->store.isNull() ? none : this->store->at(this->index);
+}
+
+bool SearchResult::operator<(const SearchResult &o) const
+{
+	if(this->score != o.score)
+	{
+		return this->score < o.score;
+	}
+	const EntryConfig &entry = this->entry();
+	const EntryConfig &other = o.entry();
+	int cmp = entry.name.compare(other.name, Qt::CaseInsensitive);
+	if(cmp != 0)
+	{
+		return cmp < 0;
+	}
+	return entry.entryPath < other.entryPath;
+}
+
+int SearchProvider::tier() const
+{
+	return 0;
+}
+
+QVector<SearchResult> SearchProvider::detachedResults(const QVector<EntryConfig> &entries, const QVector<int> &scores)
+{
+	EntryStorePtr store = EntryStore::detached(entries);
+	QVector<SearchResult> results(entries.size());
+	for(int i = 0; i < entries.size(); i++)
+	{
+		results[i].store = store;
+		results[i].index = i;
+		results[i].score = scores[i];
+	}
+	return results;
+}
+
+/* Queries starting with one of these are reserved for a specific provider */
+static const QString MODE_PREFIXES = "=#?";
+
+bool SearchProvider::handles(const QString &query) const
+{
+	return !query.isEmpty() && !isModeQuery(query);
+}
+
+bool isModeQuery(const QString &query)
+{
+	return query.length() >= 2 && MODE_PREFIXES.contains(query[0]);
+}
+
+bool isCalculationQuery(const QString &query)
+{
+	return query.length() >= 2 && query[0] == '=';
+}
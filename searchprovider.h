@@ -0,0 +1,60 @@
+#ifndef SEARCHPROVIDER_H
+#define SEARCHPROVIDER_H
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "cancellationtoken.h"
+#include "entrystore.h"
+
+class SearchResult
+{
+  public:
+	enum Kind
+	{
+		ENTRY,
+		CALCULATION
+	};
+	Kind kind = ENTRY;
+	/* The entry, by its index in store. Entries that are not part of the catalog come with a store of their own */
+	EntryStorePtr store;
+	int index = 0;
+	/* For calculations */
+	QString expression;
+	QString value;
+	/* Lower is better */
+	int score = 0;
+
+	/* An empty entry for calculations */
+	const EntryConfig &entry() const;
+	/* Total order: score first, ties broken by name and then by path so results don't jump around */
+	bool operator<(const SearchResult &o) const;
+};
+
+typedef std::function<void(QVector<SearchResult>)> SearchResultCallback;
+
+/* A source of search results. search() runs on a worker thread and may be called concurrently
+ * for different queries, so implementations must be thread-safe. Partial results can be passed to the
+ * callback as soon as they are available, it can be called multiple times */
+class SearchProvider
+{
+  public:
+	virtual ~SearchProvider() = default;
+	virtual QString name() const = 0;
+	/* Results of a tier are only shown if all lower tiers had nothing to offer */
+	virtual int tier() const;
+	/* After this many milliseconds the search is cancelled and late results are dropped */
+	virtual int latencyBudget() const = 0;
+	virtual bool handles(const QString &query) const;
+	virtual void search(const QString &query, const CancellationToken &token,
+						const SearchResultCallback &emitResults) = 0;
+
+  protected:
+	/* Results for entries that are not part of the catalog, all in one store */
+	static QVector<SearchResult> detachedResults(const QVector<EntryConfig> &entries, const QVector<int> &scores);
+};
+
+/* Whether the query selects a specific search mode, like '=' for calculations */
+bool isModeQuery(const QString &query);
+bool isCalculationQuery(const QString &query);
+
+#endif // SEARCHPROVIDER_H
@@ -1,40 +1,178 @@
 #include "settingsprovider.h"
+#include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+
+/* Editors tend to write files in several steps, so wait until it has settled */
+static const int RELOAD_DELAY_MSECS = 250;
+
+bool SettingsSnapshot::operator==(const SettingsSnapshot &o) const
+{
+	return userEntriesPaths == o.userEntriesPaths &&
+		   systemApplicationsEntriesPaths == o.systemApplicationsEntriesPaths && maxCols == o.maxCols &&
+		   singleInstanceMode == o.singleInstanceMode && fileSearchEnabled == o.fileSearchEnabled &&
+		   fileSearchRoots == o.fileSearchRoots && fileSearchExcludes == o.fileSearchExcludes &&
+		   contentSearchEnabled == o.contentSearchEnabled && contentSearchRoots == o.contentSearchRoots &&
+		   contentSearchExtensions == o.contentSearchExtensions && terminalCommand == o.terminalCommand &&
+		   socketPath == o.socketPath && stallThresholdMsecs == o.stallThresholdMsecs &&
+		   stallBacktrace == o.stallBacktrace;
+}
 
 SettingsProvider::SettingsProvider(QSettings &settings)
 {
 	this->settings = &settings;
+	this->snapshot.reset(new SettingsSnapshot(read()));
+
+	this->reloadTimer.setSingleShot(true);
+	this->reloadTimer.setInterval(RELOAD_DELAY_MSECS);
+	connect(&this->reloadTimer, &QTimer::timeout, this, &SettingsProvider::reload);
+	connect(&this->watcher, &QFileSystemWatcher::fileChanged, &this->reloadTimer, qOverload<>(&QTimer::start));
+	connect(&this->watcher, &QFileSystemWatcher::directoryChanged, &this->reloadTimer,
+			qOverload<>(&QTimer::start));
+	watch();
 }
 
-QStringList SettingsProvider::userEntriesPaths() const
+void SettingsProvider::watch()
 {
+	QFileInfo fi(this->settings->fileName());
+	/* The directory is watched too, as editors often replace the file, which ends a watch on it */
+	if(!this->watcher.directories().contains(fi.absolutePath()))
+	{
+		this->watcher.addPath(fi.absolutePath());
+	}
+	if(fi.exists() && !this->watcher.files().contains(fi.absoluteFilePath()))
+	{
+		this->watcher.addPath(fi.absoluteFilePath());
+	}
+}
+
+SettingsSnapshot SettingsProvider::read() const
+{
+	SettingsSnapshot result;
 	// TODO: make it configurable, but we stick with this for now.
 	QFileInfo fi(this->settings->fileName());
-	return {fi.absoluteDir().absolutePath()};
+	result.userEntriesPaths = QStringList{fi.absoluteDir().absolutePath()};
+	result.systemApplicationsEntriesPaths = settings->value("sysAppsPaths", "/usr/share/applications/").toStringList();
+	result.maxCols = settings->value("maxColumns", 3).toInt();
+	result.singleInstanceMode = settings->value("singleInstance", true).toBool();
+	/* Opt-in: it watches every directory below the roots and walks them on each start */
+	result.fileSearchEnabled = settings->value("fileSearch", false).toBool();
+	result.fileSearchRoots = settings->value("fileSearchRoots", QDir::homePath()).toStringList();
+	result.fileSearchExcludes =
+		settings->value("fileSearchExcludes", QStringList{".git", ".cache", "node_modules"}).toStringList();
+	/* Opt-in as well, it reads and tokenizes every document below the roots */
+	result.contentSearchEnabled = settings->value("contentSearch", false).toBool();
+	result.contentSearchRoots =
+		settings->value("contentSearchRoots", QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation))
+			.toStringList();
+	result.contentSearchExtensions =
+		settings->value("contentSearchExtensions", QStringList{"txt", "md", "org", "rst", "tex", "csv"})
+			.toStringList();
+	result.terminalCommand = settings->value("terminal", "/usr/bin/x-terminal-emulator -e %c").toString();
+	result.socketPath = settings->value("singleInstanceSocket", "/tmp/qsrun").toString();
+	result.stallThresholdMsecs = settings->value("stallThreshold", 250).toInt();
+	result.stallBacktrace = settings->value("stallBacktrace", false).toBool();
+	if(result.maxCols < 1)
+	{
+		result.maxCols = 1;
+	}
+	return result;
+}
+
+void SettingsProvider::reload()
+{
+	watch();
+	this->settings->sync();
+	QSharedPointer<const SettingsSnapshot> next(new SettingsSnapshot(read()));
+	QSharedPointer<const SettingsSnapshot> previous = current();
+	/* The directory also contains the entries, so most changes are not ours */
+	if(*next == *previous)
+	{
+		return;
+	}
+	{
+		QMutexLocker locker(&this->mutex);
+		previous = this->snapshot;
+		this->snapshot = next;
+	}
+	qInfo() << "Reloaded settings from" << this->settings->fileName();
+	emit settingsChanged(previous, next);
+}
+
+QSharedPointer<const SettingsSnapshot> SettingsProvider::current() const
+{
+	QMutexLocker locker(&this->mutex);
+	return this->snapshot;
+}
+
+QStringList SettingsProvider::userEntriesPaths() const
+{
+	return current()->userEntriesPaths;
 }
 
 QStringList SettingsProvider::systemApplicationsEntriesPaths() const
 {
-	return settings->value("sysAppsPaths", "/usr/share/applications/").toStringList();
+	return current()->systemApplicationsEntriesPaths;
 }
 
 int SettingsProvider::getMaxCols() const
 {
-	return settings->value("maxColumns", 3).toInt();
+	return current()->maxCols;
 }
 
 bool SettingsProvider::singleInstanceMode() const
 {
-	return settings->value("singleInstance", true).toBool();
+	return current()->singleInstanceMode;
+}
+
+bool SettingsProvider::fileSearchEnabled() const
+{
+	return current()->fileSearchEnabled;
+}
+
+QStringList SettingsProvider::fileSearchRoots() const
+{
+	return current()->fileSearchRoots;
+}
+
+QStringList SettingsProvider::fileSearchExcludes() const
+{
+	return current()->fileSearchExcludes;
+}
+
+bool SettingsProvider::contentSearchEnabled() const
+{
+	return current()->contentSearchEnabled;
+}
+
+QStringList SettingsProvider::contentSearchRoots() const
+{
+	return current()->contentSearchRoots;
+}
+
+QStringList SettingsProvider::contentSearchExtensions() const
+{
+	return current()->contentSearchExtensions;
 }
 
 QString SettingsProvider::getTerminalCommand() const
 {
-	return settings->value("terminal", "/usr/bin/x-terminal-emulator -e %c").toString();
+	return current()->terminalCommand;
 }
 
 QString SettingsProvider::socketPath() const
 {
-	return settings->value("singleInstanceSocket", "/tmp/qsrun").toString();
+	return current()->socketPath;
+}
+
+int SettingsProvider::stallThresholdMsecs() const
+{
+	return current()->stallThresholdMsecs;
+}
+
+bool SettingsProvider::stallBacktrace() const
+{
+	return current()->stallBacktrace;
 }
@@ -1,22 +1,70 @@
 #ifndef SETTINGSPROVIDER_H
 #define SETTINGSPROVIDER_H
 
+#include <QFileSystemWatcher>
+#include <QMutex>
+#include <QObject>
 #include <QSettings>
+#include <QSharedPointer>
+#include <QTimer>
 #include <stdexcept>
 
-class SettingsProvider
+/* Parsed settings. Immutable once published, a change of the config file produces a new one */
+class SettingsSnapshot
 {
+  public:
+	QStringList userEntriesPaths;
+	QStringList systemApplicationsEntriesPaths;
+	int maxCols = 3;
+	bool singleInstanceMode = true;
+	bool fileSearchEnabled = false;
+	QStringList fileSearchRoots;
+	QStringList fileSearchExcludes;
+	bool contentSearchEnabled = false;
+	QStringList contentSearchRoots;
+	QStringList contentSearchExtensions;
+	QString terminalCommand;
+	QString socketPath;
+	int stallThresholdMsecs = 250;
+	bool stallBacktrace = false;
+
+	bool operator==(const SettingsSnapshot &o) const;
+};
+
+class SettingsProvider : public QObject
+{
+	Q_OBJECT
   private:
 	QSettings *settings;
+	mutable QMutex mutex;
+	QSharedPointer<const SettingsSnapshot> snapshot;
+	QFileSystemWatcher watcher;
+	QTimer reloadTimer;
+
+	SettingsSnapshot read() const;
+	void watch();
 
   public:
 	SettingsProvider(QSettings &settings);
+	QSharedPointer<const SettingsSnapshot> current() const;
+	void reload();
 	virtual QStringList userEntriesPaths() const;
 	virtual QStringList systemApplicationsEntriesPaths() const;
 	virtual int getMaxCols() const;
 	virtual bool singleInstanceMode() const;
+	bool fileSearchEnabled() const;
+	QStringList fileSearchRoots() const;
+	QStringList fileSearchExcludes() const;
+	bool contentSearchEnabled() const;
+	QStringList contentSearchRoots() const;
+	QStringList contentSearchExtensions() const;
 	QString getTerminalCommand() const;
 	QString socketPath() const;
+	int stallThresholdMsecs() const;
+	bool stallBacktrace() const;
+
+  signals:
+	void settingsChanged(QSharedPointer<const SettingsSnapshot> previous, QSharedPointer<const SettingsSnapshot> current);
 };
 
 #endif // SETTINGSPROVIDER_H
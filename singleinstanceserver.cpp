@@ -3,6 +3,7 @@
 #include <QFile>
 
 #include "singleinstanceserver.h"
+#include "stallwatchdog.h"
 
 SingleInstanceServer::SingleInstanceServer()
 {
@@ -16,6 +17,7 @@ bool SingleInstanceServer::listen(QString socketPath)
 }
 void SingleInstanceServer::handleNewConnection()
 {
+	PhaseScope phase("IPC read");
 	QScopedPointer<QLocalSocket> socket { this->server.nextPendingConnection() };
 	if(!socket.isNull())
 	{
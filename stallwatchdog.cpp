@@ -0,0 +1,228 @@
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <execinfo.h>
+#include <ucontext.h>
+#include "metrics.h"
+#include "stallwatchdog.h"
+
+static std::atomic<const char *> guiPhase{nullptr};
+
+static const int MAX_BACKTRACE_FRAMES = 64;
+static void *stallFrames[MAX_BACKTRACE_FRAMES];
+static std::atomic<int> stallFrameCount{-1};
+/* Bounds of the GUI thread's stack */
+static uintptr_t guiStackLow = 0;
+static uintptr_t guiStackHigh = 0;
+
+/* backtrace() is not async-signal-safe, so this follows the frame pointers itself, only reading
+ * within the GUI thread's stack. Without frame pointers, that is just the interrupted location */
+static void backtraceSignalHandler(int, siginfo_t *, void *context)
+{
+	const ucontext_t *ucontext = static_cast<const ucontext_t *>(context);
+	uintptr_t pc;
+	uintptr_t fp;
+#if defined(__x86_64__)
+	pc = ucontext->uc_mcontext.gregs[REG_RIP];
+	fp = ucontext->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+	pc = ucontext->uc_mcontext.pc;
+	fp = ucontext->uc_mcontext.regs[29];
+#else
+	(void)ucontext;
+	stallFrameCount.store(0);
+	return;
+#endif
+	int count = 0;
+	stallFrames[count++] = reinterpret_cast<void *>(pc);
+	while(count < MAX_BACKTRACE_FRAMES && fp % sizeof(uintptr_t) == 0 && fp >= guiStackLow &&
+		  fp + 2 * sizeof(uintptr_t) <= guiStackHigh)
+	{
+		const uintptr_t *frame = reinterpret_cast<const uintptr_t *>(fp);
+		if(frame[1] == 0 || frame[0] <= fp)
+		{
+			break;
+		}
+		stallFrames[count++] = reinterpret_cast<void *>(frame[1]);
+		fp = frame[0];
+	}
+	stallFrameCount.store(count);
+}
+
+PhaseScope::PhaseScope(const char *phase)
+{
+	QCoreApplication *app = QCoreApplication::instance();
+	this->active = app != nullptr && QThread::currentThread() == app->thread();
+	if(this->active)
+	{
+		this->previous = guiPhase.exchange(phase);
+	}
+}
+
+PhaseScope::~PhaseScope()
+{
+	if(this->active)
+	{
+		guiPhase.store(this->previous);
+	}
+}
+
+qint64 StallWatchdog::now()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+StallWatchdog::StallWatchdog(int thresholdMsecs, QString logFilePath, bool backtraces)
+{
+	this->thresholdMsecs = thresholdMsecs;
+	this->logFilePath = logFilePath;
+	this->backtraces = backtraces;
+	this->guiThread = pthread_self();
+	this->lastHeartbeat.store(now());
+
+	if(backtraces)
+	{
+		pthread_attr_t attributes;
+		void *stack;
+		size_t stackSize;
+		if(pthread_getattr_np(this->guiThread, &attributes) == 0)
+		{
+			if(pthread_attr_getstack(&attributes, &stack, &stackSize) == 0)
+			{
+				guiStackLow = reinterpret_cast<uintptr_t>(stack);
+				guiStackHigh = guiStackLow + stackSize;
+			}
+			pthread_attr_destroy(&attributes);
+		}
+		struct sigaction action;
+		std::memset(&action, 0, sizeof(action));
+		action.sa_sigaction = backtraceSignalHandler;
+		action.sa_flags = SA_RESTART | SA_SIGINFO;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGUSR2, &action, nullptr);
+	}
+
+	this->heartbeatTimer.setInterval(std::max(10, thresholdMsecs / 4));
+	connect(&this->heartbeatTimer, &QTimer::timeout, this, [this] { this->lastHeartbeat.store(now()); });
+	this->heartbeatTimer.start();
+
+	this->watcher = QThread::create([this] { watch(); });
+	this->watcher->start();
+}
+
+StallWatchdog::~StallWatchdog()
+{
+	{
+		QMutexLocker locker(&this->mutex);
+		this->stopping.store(true);
+		this->resumed.wakeAll();
+	}
+	this->watcher->wait();
+	delete this->watcher;
+}
+
+void StallWatchdog::pause()
+{
+	QMutexLocker locker(&this->mutex);
+	this->paused = true;
+	this->heartbeatTimer.stop();
+}
+
+void StallWatchdog::resume()
+{
+	QMutexLocker locker(&this->mutex);
+	/* The time spent paused is no stall */
+	this->lastHeartbeat.store(now());
+	this->paused = false;
+	this->heartbeatTimer.start();
+	this->resumed.wakeAll();
+}
+
+void StallWatchdog::watch()
+{
+	const int interval = std::max(10, this->thresholdMsecs / 4);
+	bool stalled = false;
+	qint64 stallStart = 0;
+	const char *stallPhase = nullptr;
+	QStringList stallBacktrace;
+	while(!this->stopping.load())
+	{
+		{
+			QMutexLocker locker(&this->mutex);
+			while(this->paused && !this->stopping.load())
+			{
+				this->resumed.wait(&this->mutex);
+			}
+		}
+		QThread::msleep(interval);
+		qint64 heartbeat = this->lastHeartbeat.load();
+		qint64 sinceHeartbeat = now() - heartbeat;
+		if(!stalled && sinceHeartbeat > this->thresholdMsecs)
+		{
+			/* The GUI thread is still stuck, so whatever it marked is what it is stuck in */
+			stalled = true;
+			stallStart = heartbeat;
+			stallPhase = guiPhase.load();
+			stallBacktrace.clear();
+			if(this->backtraces)
+			{
+				stallFrameCount.store(-1);
+				pthread_kill(this->guiThread, SIGUSR2);
+				for(int i = 0; i < 10 && stallFrameCount.load() < 0; i++)
+				{
+					QThread::msleep(10);
+				}
+				int count = stallFrameCount.load();
+				if(count > 0)
+				{
+					char **symbols = backtrace_symbols(stallFrames, count);
+					for(int i = 0; symbols != nullptr && i < count; i++)
+					{
+						stallBacktrace.append(symbols[i]);
+					}
+					free(symbols);
+				}
+			}
+		}
+		else if(stalled && heartbeat != stallStart)
+		{
+			stalled = false;
+			report(heartbeat - stallStart, stallPhase, stallBacktrace);
+		}
+	}
+}
+
+void StallWatchdog::report(qint64 durationMsecs, const char *phase, const QStringList &backtrace)
+{
+	QString phaseName = phase != nullptr ? phase : "unknown";
+	Metrics::instance().add("watchdog.stalls");
+	Metrics::instance().add("watchdog.stalls." + phaseName);
+	Metrics::instance().add("watchdog.stall_msecs", durationMsecs);
+	qWarning() << "GUI thread stalled for" << durationMsecs << "ms in phase:" << phaseName;
+
+	QDir().mkpath(QFileInfo(this->logFilePath).absolutePath());
+	QFile file(this->logFilePath);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+	{
+		return;
+	}
+	QTextStream stream(&file);
+	stream << QDateTime::currentDateTime().toString(Qt::ISODate) << "\tstall\t" << durationMsecs << "ms\t"
+		   << phaseName;
+	if(!backtrace.isEmpty())
+	{
+		stream << "\t" << backtrace.join(" | ");
+	}
+	stream << "\n";
+}
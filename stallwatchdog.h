@@ -0,0 +1,55 @@
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QWaitCondition>
+#include <atomic>
+#include <pthread.h>
+
+/* Marks what the GUI thread is doing, so a stall can be attributed. Has no effect on other threads */
+class PhaseScope
+{
+  private:
+	const char *previous = nullptr;
+	bool active = false;
+
+  public:
+	PhaseScope(const char *phase);
+	~PhaseScope();
+};
+
+/* Detects stalls of the GUI event loop: a timer in the GUI thread updates a heartbeat, a thread
+ * checks that it keeps coming. Stalls above the threshold are logged with the active phase and
+ * optionally a backtrace of the GUI thread. Nobody waits for a hidden window, so it can be paused
+ * meanwhile, then neither wakes up. */
+class StallWatchdog : public QObject
+{
+	Q_OBJECT
+  private:
+	int thresholdMsecs;
+	QString logFilePath;
+	bool backtraces;
+	pthread_t guiThread;
+	std::atomic<qint64> lastHeartbeat;
+	std::atomic<bool> stopping{false};
+	QMutex mutex;
+	QWaitCondition resumed;
+	bool paused = false;
+	QTimer heartbeatTimer;
+	QThread *watcher = nullptr;
+
+	static qint64 now();
+	void watch();
+	void report(qint64 durationMsecs, const char *phase, const QStringList &backtrace);
+
+  public:
+	StallWatchdog(int thresholdMsecs, QString logFilePath, bool backtraces);
+	~StallWatchdog();
+	void pause();
+	void resume();
+};
+
+#endif // STALLWATCHDOG_H
@@ -0,0 +1,266 @@
+#include <QMutexLocker>
+#include <algorithm>
+#include <thread>
+#include "taskscheduler.h"
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/* Index of the worker the current thread is, -1 for other threads */
+static thread_local int currentWorker = -1;
+
+/* QThread::setPriority() can't take a thread out of SCHED_IDLE again, so switch the policy directly */
+static void setBackground(bool background)
+{
+#ifdef Q_OS_LINUX
+	sched_param param = {};
+	pthread_setschedparam(pthread_self(), background ? SCHED_IDLE : SCHED_OTHER, &param);
+#else
+	QThread::currentThread()->setPriority(background ? QThread::IdlePriority : QThread::NormalPriority);
+#endif
+}
+
+TaskGroup::~TaskGroup()
+{
+	wait();
+}
+
+void TaskGroup::enter()
+{
+	QMutexLocker locker(&this->mutex);
+	++this->running;
+}
+
+void TaskGroup::leave()
+{
+	QMutexLocker locker(&this->mutex);
+	if(--this->running == 0)
+	{
+		this->done.wakeAll();
+	}
+}
+
+void TaskGroup::wait()
+{
+	QMutexLocker locker(&this->mutex);
+	while(this->running > 0)
+	{
+		this->done.wait(&this->mutex);
+	}
+}
+
+TaskScheduler &TaskScheduler::instance()
+{
+	static TaskScheduler scheduler;
+	return scheduler;
+}
+
+TaskScheduler::TaskScheduler()
+{
+	int count = std::max(2, QThread::idealThreadCount());
+	this->maxBackgroundWorkers = count - 1;
+	for(int i = 0; i < count; i++)
+	{
+		this->workers.emplace_back(new Worker());
+	}
+	for(int i = 0; i < count; i++)
+	{
+		Worker &worker = *this->workers[i];
+		worker.thread = QThread::create([this, i] { workerLoop(i); });
+		worker.thread->setObjectName(QString("qsrun worker %1").arg(i));
+		worker.thread->start();
+	}
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	this->stopping.store(true);
+	notify(true);
+	for(auto &worker : this->workers)
+	{
+		worker->thread->wait();
+		delete worker->thread;
+		/* Whatever did not run anymore */
+		for(std::deque<Job> &queue : worker->queues)
+		{
+			for(Job &job : queue)
+			{
+				if(job.group != nullptr)
+				{
+					job.group->leave();
+				}
+			}
+		}
+	}
+}
+
+int TaskScheduler::workerCount() const
+{
+	return this->workers.size();
+}
+
+void TaskScheduler::notify(bool all)
+{
+	QMutexLocker locker(&this->sleepMutex);
+	++this->epoch;
+	if(all)
+	{
+		this->wakeUp.wakeAll();
+	}
+	else
+	{
+		this->wakeUp.wakeOne();
+	}
+}
+
+void TaskScheduler::schedule(Priority priority, Task task, CancellationToken token, TaskGroup *group)
+{
+	if(group != nullptr)
+	{
+		group->enter();
+	}
+	/* Tasks scheduled by tasks stay local, others are spread */
+	int target = currentWorker >= 0 ? currentWorker : this->nextWorker++ % this->workers.size();
+	Worker &worker = *this->workers[target];
+	{
+		QMutexLocker locker(&worker.mutex);
+		worker.queues[priority].push_back({std::move(task), token, group});
+	}
+	notify(false);
+}
+
+void TaskScheduler::scheduleBlocking(Task task)
+{
+	std::shared_ptr<BlockingLane> lane = this->blockingLane;
+	QMutexLocker locker(&lane->mutex);
+	lane->queue.push_back(std::move(task));
+	/* Another thread only when all of them are busy, maybe stuck */
+	if(lane->idle > 0 || lane->threads >= MAX_BLOCKING_THREADS)
+	{
+		lane->wakeUp.wakeOne();
+		return;
+	}
+	++lane->threads;
+	std::thread([lane] {
+		QMutexLocker locker(&lane->mutex);
+		for(;;)
+		{
+			while(lane->queue.empty())
+			{
+				++lane->idle;
+				bool woken = lane->wakeUp.wait(&lane->mutex, BLOCKING_IDLE_MSECS);
+				--lane->idle;
+				if(!woken && lane->queue.empty())
+				{
+					--lane->threads;
+					return;
+				}
+			}
+			Task task = std::move(lane->queue.front());
+			lane->queue.pop_front();
+			locker.unlock();
+			task();
+			locker.relock();
+		}
+	}).detach();
+}
+
+bool TaskScheduler::takeJob(int self, Job &job, Priority &priority)
+{
+	const int count = this->workers.size();
+	bool reserved = false;
+	for(int p = 0; p < PRIORITY_COUNT; p++)
+	{
+		/* Claim a background slot before looking for background work */
+		if(p == INDEXING)
+		{
+			int running = this->backgroundRunning.load();
+			do
+			{
+				if(running >= this->maxBackgroundWorkers)
+				{
+					return false;
+				}
+			} while(!this->backgroundRunning.compare_exchange_weak(running, running + 1));
+			reserved = true;
+		}
+		/* Own queue newest first (still warm in cache), stolen work oldest first */
+		for(int i = 0; i < count; i++)
+		{
+			Worker &worker = *this->workers[(self + i) % count];
+			QMutexLocker locker(&worker.mutex);
+			std::deque<Job> &queue = worker.queues[p];
+			if(queue.empty())
+			{
+				continue;
+			}
+			if(i == 0)
+			{
+				job = std::move(queue.back());
+				queue.pop_back();
+			}
+			else
+			{
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+			priority = static_cast<Priority>(p);
+			return true;
+		}
+	}
+	if(reserved)
+	{
+		--this->backgroundRunning;
+	}
+	return false;
+}
+
+void TaskScheduler::workerLoop(int self)
+{
+	currentWorker = self;
+	while(!this->stopping.load())
+	{
+		quint64 seenEpoch;
+		{
+			QMutexLocker locker(&this->sleepMutex);
+			seenEpoch = this->epoch;
+		}
+		Job job;
+		Priority priority;
+		if(!takeJob(self, job, priority))
+		{
+			QMutexLocker locker(&this->sleepMutex);
+			while(this->epoch == seenEpoch && !this->stopping.load())
+			{
+				this->wakeUp.wait(&this->sleepMutex);
+			}
+			continue;
+		}
+
+		/* takeJob() has claimed a background slot for us */
+		bool background = priority >= INDEXING;
+		if(!job.token.isCancelled())
+		{
+			if(background)
+			{
+				setBackground(true);
+			}
+			job.task();
+			if(background)
+			{
+				setBackground(false);
+			}
+		}
+		if(background)
+		{
+			--this->backgroundRunning;
+			/* Others may have skipped background work because of us */
+			notify(true);
+		}
+		if(job.group != nullptr)
+		{
+			job.group->leave();
+		}
+	}
+}
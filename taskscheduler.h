@@ -0,0 +1,123 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+#include <QFuture>
+#include <QFutureInterface>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "cancellationtoken.h"
+
+/* Tracks the tasks an object has scheduled, so it can wait for them before it goes away.
+ * Should be declared last, so it's destroyed (and waits) first */
+class TaskGroup
+{
+  private:
+	QMutex mutex;
+	QWaitCondition done;
+	int running = 0;
+
+  public:
+	~TaskGroup();
+	void enter();
+	void leave();
+	void wait();
+};
+
+/* Shared worker threads for all background work, one per core.
+ *
+ * Tasks are queued per worker and priority class. Workers take the most important task they
+ * find, from their own queues first, then by stealing from the others. Lower classes run with
+ * idle OS priority, and never on all workers at once, so a worker is always left for queries.
+ *
+ * Work that may block indefinitely, like stat() on a hung network mount, does not belong on the
+ * workers; it goes to the separate blocking lane instead */
+class TaskScheduler
+{
+  public:
+	enum Priority
+	{
+		INTERACTIVE, /* the current query */
+		VISIBLE,	 /* what is about to be shown, e. g. the catalog */
+		INDEXING,
+		MAINTENANCE, /* saving caches and the like */
+		PRIORITY_COUNT
+	};
+	typedef std::function<void()> Task;
+	static const int MAX_BLOCKING_THREADS = 8;
+	/* Blocking lane threads end after being idle this long */
+	static const int BLOCKING_IDLE_MSECS = 30000;
+
+  private:
+	struct Job
+	{
+		Task task;
+		CancellationToken token;
+		TaskGroup *group;
+	};
+	struct Worker
+	{
+		QMutex mutex;
+		std::deque<Job> queues[PRIORITY_COUNT];
+		QThread *thread = nullptr;
+	};
+
+	/* Shared with the lane's threads, which are detached and may outlive the scheduler */
+	struct BlockingLane
+	{
+		QMutex mutex;
+		QWaitCondition wakeUp;
+		std::deque<Task> queue;
+		int threads = 0;
+		int idle = 0;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::shared_ptr<BlockingLane> blockingLane{new BlockingLane()};
+	int maxBackgroundWorkers;
+	std::atomic<int> backgroundRunning{0};
+	std::atomic<unsigned int> nextWorker{0};
+	std::atomic<bool> stopping{false};
+	/* Changes whenever there might be new work, guarded by sleepMutex */
+	quint64 epoch = 0;
+	QMutex sleepMutex;
+	QWaitCondition wakeUp;
+
+	TaskScheduler();
+	bool takeJob(int self, Job &job, Priority &priority);
+	void workerLoop(int self);
+	void notify(bool all);
+
+  public:
+	static TaskScheduler &instance();
+	~TaskScheduler();
+	int workerCount() const;
+	/* Runs task on a worker, unless token is cancelled before it starts */
+	void schedule(Priority priority, Task task, CancellationToken token = {}, TaskGroup *group = nullptr);
+	/* Runs task on one of up to MAX_BLOCKING_THREADS threads of its own, so tasks stuck in blocking I/O
+	 * can't hold up the workers. Its threads are never waited for: tasks still queued or running at
+	 * exit are abandoned, so they must not refer to anything that might be gone by the time they
+	 * finish */
+	void scheduleBlocking(Task task);
+	/* Like QtConcurrent::run(), for use with QFutureWatcher */
+	template <typename T> QFuture<T> run(Priority priority, std::function<T()> function);
+};
+
+template <typename T> QFuture<T> TaskScheduler::run(Priority priority, std::function<T()> function)
+{
+	QSharedPointer<QFutureInterface<T>> interface(new QFutureInterface<T>());
+	interface->reportStarted();
+	QFuture<T> future = interface->future();
+	schedule(priority, [interface, function] {
+		interface->reportResult(function());
+		interface->reportFinished();
+	});
+	return future;
+}
+
+#endif // TASKSCHEDULER_H
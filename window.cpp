@@ -17,23 +17,96 @@
 #include <QDate>
 #include <QDebug>
 #include <QDesktopServices>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QDirIterator>
+#include <QFutureWatcher>
 #include <QFileIconProvider>
 #include <QHeaderView>
 #include <QIcon>
+#include <QJsonDocument>
 #include <QKeySequence>
 #include <QLabel>
+#include <QMap>
 #include <QMenu>
+#include <QPixmapCache>
 #include <QProcess>
 #include <QProcessEnvironment>
 #include <QScrollArea>
+#include <QScrollBar>
+#include <QStandardPaths>
+#include <algorithm>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
+#include "calculationengine.h"
+#include "calculatorsearchprovider.h"
+#include "contentsearchprovider.h"
+#include "entrylauncher.h"
 #include "entryprovider.h"
+#include "executesearchprovider.h"
+#include "filesearchprovider.h"
+#include "historysearchprovider.h"
+#include "iconthemeindex.h"
+#include "memoryaccounting.h"
+#include "metrics.h"
+#include "pathsearchprovider.h"
+#include "pixmapcache.h"
+#include "stallwatchdog.h"
+#include "taskscheduler.h"
 #include "window.h"
+
+/* Number of rows of results added to the grid at once, more are loaded when scrolling down */
+static const int RESULT_PAGE_ROWS = 8;
+/* Transient buttons kept around for the next search, the others are deleted */
+static const int MAX_IDLE_TRANSIENT_BUTTONS = 64;
+/* Time for inserting buttons into the grid, per event loop iteration */
+static const int FRAME_BUDGET_MSECS = 8;
+/* Used until the size of a button is known */
+static const int FALLBACK_VISIBLE_ROWS = 4;
+/* How long to stay hidden before each level of trimMemory() */
+static const int IDLE_TRIM_LEVELS = 2;
+static const int IDLE_TRIM_INTERVALS_MSECS[IDLE_TRIM_LEVELS] = {60 * 1000, 10 * 60 * 1000};
+
 Window::Window(EntryProvider &entryProvider, SettingsProvider &configProvider)
 {
 	this->entryProvider = &entryProvider;
 	this->settingsProvider = &configProvider;
+	this->entrySearchProvider.reset(new EntrySearchProvider());
+	searchDispatcher.addProvider(this->entrySearchProvider);
+	searchDispatcher.addProvider(QSharedPointer<SearchProvider>(new CalculatorSearchProvider()));
+	searchDispatcher.addProvider(QSharedPointer<SearchProvider>(new PathSearchProvider()));
+	searchDispatcher.addProvider(QSharedPointer<SearchProvider>(new ExecuteSearchProvider()));
+	this->commandHistory.reset(
+		new CommandHistory(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/history"));
+	QSharedPointer<CommandHistory> history = this->commandHistory;
+	TaskScheduler::instance().schedule(TaskScheduler::VISIBLE, [history] { history->load(); });
+	searchDispatcher.addProvider(QSharedPointer<SearchProvider>(new HistorySearchProvider(history)));
+	QSharedPointer<const SettingsSnapshot> settings = settingsProvider->current();
+	setupFileSearch(*settings);
+	setupContentSearch(*settings);
+	setupStallWatchdog(*settings);
+	connect(&searchDispatcher, &SearchDispatcher::resultsChanged, this, &Window::showSearchResults);
+	connect(settingsProvider, &SettingsProvider::settingsChanged, this, &Window::settingsChanged);
+	connect(&persistenceQueue, &PersistenceQueue::saveFailed, this, [this](QString path, QString error) {
+		QMessageBox::critical(this, "Failed to save entry", path + ": " + error);
+	});
+	this->gridFillTimer.setSingleShot(true);
+	this->gridFillTimer.setInterval(0);
+	connect(&this->gridFillTimer, &QTimer::timeout, this, [this] { fillGrid(0); });
+	this->idleTrimTimer.setSingleShot(true);
+	connect(&this->idleTrimTimer, &QTimer::timeout, this, [this] {
+		trimMemory(++this->idleTrimLevel);
+		if(this->idleTrimLevel < IDLE_TRIM_LEVELS)
+		{
+			this->idleTrimTimer.start(IDLE_TRIM_INTERVALS_MSECS[this->idleTrimLevel]);
+		}
+	});
+	connect(qApp, &QCoreApplication::aboutToQuit, this, [this] {
+		persistenceQueue.flush();
+		PixmapCache::instance().save();
+	});
 	createGui();
 	initFromConfig();
 	this->lineEdit->installEventFilter(this);
@@ -55,53 +128,242 @@ Window::~Window()
 
 void Window::initFromConfig()
 {
+	PhaseScope phase("reading user entries");
+	/* Make sure we read what we have saved */
+	persistenceQueue.flush();
+	/* Only the favourites are needed for the first paint. The system entries, possibly many, are
+	 * read in the background, until then the previous ones (if any) stay */
 	try
 	{
-		this->userEntryButtons = generateEntryButtons(entryProvider->getUserEntries());
-		this->systemEntryButtons = generateEntryButtons(entryProvider->getSystemEntries());
+		this->entryStore.reset(new EntryStore(entryProvider->getUserEntries(), entryStore->systemEntries()));
 	}
 	catch(const ConfigFormatException &e)
 	{
 		qDebug() << "Config is misformated: " << e.what();
 		QMessageBox::critical(this, "Misformated config file", e.what());
 		qApp->quit();
+		return;
 	}
+	this->userEntryButtons = reconcileEntryButtons(this->userEntryButtons, 0, entryStore->userCount());
+	rebindEntryButtons(this->systemEntryButtons, entryStore->userCount());
 
+	updateSearchableEntries();
 	populateGrid(this->userEntryButtons);
+	loadSystemEntries();
 }
 
-void Window::showCalculationResultContextMenu(const QPoint &point)
+void Window::loadSystemEntries()
 {
-	QMenu menu("Calc", this);
-	menu.addAction("Copy result", [&] { QGuiApplication::clipboard()->setText(currentCalculationResult); });
-	menu.addAction("Copy full content", [&] { QGuiApplication::clipboard()->setText(calculationResultLabel.text()); });
-	menu.exec(QCursor::pos());
+	typedef QPair<QVector<EntryConfig>, QString> LoadResult;
+	/* A copy, so the paths can't change under the hood */
+	EntryProvider provider = *this->entryProvider;
+	quint64 generation = ++this->systemEntriesGeneration;
+	this->systemEntriesLoading = true;
+	QFutureWatcher<LoadResult> *watcher = new QFutureWatcher<LoadResult>(this);
+	connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation] {
+		watcher->deleteLater();
+		/* superseded by a newer load */
+		if(generation != this->systemEntriesGeneration)
+		{
+			return;
+		}
+		this->systemEntriesLoading = false;
+		LoadResult result = watcher->result();
+		if(!result.second.isEmpty())
+		{
+			qDebug() << "Config is misformated: " << result.second;
+			QMessageBox::critical(this, "Misformated config file", result.second);
+			return;
+		}
+		setSystemConfig(result.first);
+	});
+	watcher->setFuture(TaskScheduler::instance().run<LoadResult>(TaskScheduler::VISIBLE, [provider]() mutable {
+		AllocationScope allocations(MemoryAccounting::ENTRIES);
+		/* Until then, icons are looked up by QIcon::fromTheme(). On reloads, this picks up
+		 * changed theme directories */
+		IconThemeIndex::instance().ensureLoaded();
+		try
+		{
+			return LoadResult(provider.getSystemEntries(), QString());
+		}
+		catch(const std::exception &e)
+		{
+			return LoadResult({}, e.what());
+		}
+	}));
 }
 
-QVector<EntryPushButton *> Window::generateEntryButtons(const QVector<EntryConfig> &configs)
+/* userEntryButtons and systemEntryButtons must be in the order of the store */
+void Window::updateSearchableEntries()
 {
-	QVector<EntryPushButton *> result;
-	for(const EntryConfig &config : configs)
+	this->buttonsByPath.clear();
+	for(int i = 0; i < this->userEntryButtons.size(); i++)
 	{
-		EntryPushButton *button = createEntryButton(config);
-		result.append(button);
+		this->buttonsByPath[entryStore->at(i).entryPath] = this->userEntryButtons[i];
+	}
+	for(int i = 0; i < this->systemEntryButtons.size(); i++)
+	{
+		if(this->systemEntryButtons[i] != nullptr)
+		{
+			this->buttonsByPath[entryStore->at(entryStore->userCount() + i).entryPath] = this->systemEntryButtons[i];
+		}
+	}
+	this->entrySearchProvider->setEntries(this->entryStore);
+	this->entrySearchProvider->prefillCache();
+}
+
+/* Points buttons, the ones of the entries from begin on in the store, to the current store. System entry
+ * buttons not created yet are skipped */
+void Window::rebindEntryButtons(const QVector<EntryPushButton *> &buttons, int begin)
+{
+	for(int i = 0; i < buttons.size(); i++)
+	{
+		if(buttons[i] != nullptr)
+		{
+			buttons[i]->rebind(this->entryStore, begin + i);
+		}
 	}
-	return result;
+}
+
+/* Replaces the store, keeping the existing buttons of the user entries. The system entries must not have changed */
+void Window::setEntryStore(EntryStorePtr store)
+{
+	this->entryStore = store;
+	rebindEntryButtons(this->userEntryButtons, 0);
+	rebindEntryButtons(this->systemEntryButtons, store->userCount());
+}
+
+/* The button of the system entry at index, created when it is shown for the first time */
+EntryPushButton *Window::systemEntryButton(int index)
+{
+	EntryPushButton *&button = this->systemEntryButtons[index - this->entryStore->userCount()];
+	if(button == nullptr)
+	{
+		button = createEntryButton(this->entryStore, index);
+		this->buttonsByPath[this->entryStore->at(index).entryPath] = button;
+	}
+	return button;
+}
+
+void Window::setupFileSearch(const SettingsSnapshot &settings)
+{
+	if(!this->fileSearchProvider.isNull())
+	{
+		searchDispatcher.removeProvider(this->fileSearchProvider);
+		this->fileSearchProvider.reset();
+	}
+	if(settings.fileSearchEnabled)
+	{
+		QString indexFilePath =
+			QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/filenames.idx";
+		this->fileSearchProvider.reset(
+			new FileSearchProvider(settings.fileSearchRoots, settings.fileSearchExcludes, indexFilePath));
+		searchDispatcher.addProvider(this->fileSearchProvider);
+	}
+}
+
+void Window::setupContentSearch(const SettingsSnapshot &settings)
+{
+	if(!this->contentSearchProvider.isNull())
+	{
+		searchDispatcher.removeProvider(this->contentSearchProvider);
+		this->contentSearchProvider.reset();
+	}
+	if(settings.contentSearchEnabled)
+	{
+		QString indexFilePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/content.idx";
+		this->contentSearchProvider.reset(
+			new ContentSearchProvider(settings.contentSearchRoots, settings.contentSearchExtensions, indexFilePath));
+		searchDispatcher.addProvider(this->contentSearchProvider);
+	}
+}
+
+void Window::setupStallWatchdog(const SettingsSnapshot &settings)
+{
+	this->stallWatchdog.reset();
+	if(settings.stallThresholdMsecs > 0)
+	{
+		QString logFilePath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/stalls.log";
+		this->stallWatchdog.reset(
+			new StallWatchdog(settings.stallThresholdMsecs, logFilePath, settings.stallBacktrace));
+		if(!isVisible())
+		{
+			this->stallWatchdog->pause();
+		}
+	}
+}
+
+void Window::settingsChanged(QSharedPointer<const SettingsSnapshot> previous,
+							 QSharedPointer<const SettingsSnapshot> current)
+{
+	/* The indexers start over with the new settings, reusing what they have indexed so far */
+	if(previous->fileSearchEnabled != current->fileSearchEnabled ||
+	   previous->fileSearchRoots != current->fileSearchRoots ||
+	   previous->fileSearchExcludes != current->fileSearchExcludes)
+	{
+		setupFileSearch(*current);
+	}
+	if(previous->contentSearchEnabled != current->contentSearchEnabled ||
+	   previous->contentSearchRoots != current->contentSearchRoots ||
+	   previous->contentSearchExtensions != current->contentSearchExtensions)
+	{
+		setupContentSearch(*current);
+	}
+	if(previous->stallThresholdMsecs != current->stallThresholdMsecs ||
+	   previous->stallBacktrace != current->stallBacktrace)
+	{
+		setupStallWatchdog(*current);
+	}
+	if(previous->userEntriesPaths != current->userEntriesPaths ||
+	   previous->systemApplicationsEntriesPaths != current->systemApplicationsEntriesPaths)
+	{
+		this->entryProvider->setEntriesDirsPaths(current->userEntriesPaths, current->systemApplicationsEntriesPaths);
+		initFromConfig();
+		lineEditTextChanged(this->lineEdit->text());
+	}
+	else if(previous->maxCols != current->maxCols && !this->searchResults.isEmpty())
+	{
+		QVector<SearchResult> results = this->searchResults;
+		showSearchResults(results, false);
+	}
+}
+
+void Window::showCalculationResultContextMenu(const QPoint &point)
+{
+	QMenu menu("Calc", this);
+	menu.addAction("Copy result", [&] { QGuiApplication::clipboard()->setText(currentCalculationResult); });
+	menu.addAction("Copy full content", [&] { QGuiApplication::clipboard()->setText(calculationResultLabel.text()); });
+	menu.exec(QCursor::pos());
 }
 
 void Window::createGui()
 {
 	QVBoxLayout *vbox = new QVBoxLayout(this);
-	QScrollArea *sa = new QScrollArea;
+	scrollArea = new QScrollArea;
 	grid = new QGridLayout();
 	lineEdit = new QLineEdit();
 	QWidget *w = new QWidget(this);
 	w->setLayout(grid);
-	sa->setWidget(w);
-	sa->setWidgetResizable(true);
+	scrollArea->setWidget(w);
+	scrollArea->setWidgetResizable(true);
 	vbox->setAlignment(Qt::AlignTop);
 	vbox->addWidget(lineEdit);
-	vbox->addWidget(sa);
+	vbox->addWidget(scrollArea);
+
+	QScrollBar *scrollBar = scrollArea->verticalScrollBar();
+	connect(scrollBar, &QScrollBar::valueChanged, this, [this, scrollBar](int value) {
+		if(value >= scrollBar->maximum() - scrollBar->pageStep() / 2)
+		{
+			showMoreResults();
+		}
+	});
+	/* If a page does not even fill the view, there is nothing to scroll, so continue right away */
+	connect(scrollBar, &QScrollBar::rangeChanged, this, [this](int min, int max) {
+		if(min == max)
+		{
+			showMoreResults();
+		}
+	});
 
 	connect(lineEdit, &QLineEdit::textChanged, this, [this](QString newtext) { this->lineEditTextChanged(newtext); });
 	connect(lineEdit, &QLineEdit::returnPressed, this, &Window::lineEditReturnPressed);
@@ -110,28 +372,199 @@ void Window::createGui()
 void Window::populateGrid(const QVector<EntryPushButton *> &list)
 {
 	clearGrid();
+	const int rows = visibleRows();
+	int firstScreen = 0;
 	for(EntryPushButton *button : list)
 	{
+		this->pendingCells.append({button, -1, button->getRow(), button->getCol()});
+		if(button->getRow() < rows)
+		{
+			firstScreen++;
+		}
+	}
+	/* The visible ones first */
+	std::stable_sort(this->pendingCells.begin(), this->pendingCells.end(),
+					 [](const PendingCell &a, const PendingCell &b) { return a.row < b.row; });
+	fillGrid(firstScreen);
+}
+
+/* How many rows of buttons fit into the view, at least one */
+int Window::visibleRows() const
+{
+	int rowHeight = 0;
+	if(!this->userEntryButtons.isEmpty())
+	{
+		rowHeight = this->userEntryButtons[0]->sizeHint().height() + this->grid->verticalSpacing();
+	}
+	if(rowHeight <= 0)
+	{
+		return FALLBACK_VISIBLE_ROWS;
+	}
+	return std::max(1, (this->scrollArea->viewport()->height() + rowHeight - 1) / rowHeight);
+}
+
+/* Puts pending cells into the grid. At least minimum of them, so the first screen is complete
+ * in the frame that follows, then as many as FRAME_BUDGET_MSECS allow. The rest continues in the
+ * next event loop iterations, giving the window the chance to paint in between */
+void Window::fillGrid(int minimum)
+{
+	PhaseScope phase("populating grid");
+	AllocationScope allocations(MemoryAccounting::GRID);
+	QElapsedTimer timer;
+	timer.start();
+	int inserted = 0;
+	while(this->nextPendingCell < this->pendingCells.size() &&
+		  (inserted < minimum || timer.elapsed() < FRAME_BUDGET_MSECS))
+	{
+		const PendingCell &cell = this->pendingCells[this->nextPendingCell++];
+		EntryPushButton *button = cell.button;
+		if(button == nullptr && cell.result < 0)
+		{
+			/* Its entry is gone */
+			continue;
+		}
+		if(button == nullptr)
+		{
+			const SearchResult &result = this->searchResults[cell.result];
+			button = this->buttonsByPath.value(result.entry().entryPath);
+			if(button == nullptr && result.store == this->entryStore && !this->entryStore->isUserEntry(result.index))
+			{
+				button = systemEntryButton(result.index);
+			}
+			if(button == nullptr)
+			{
+				button = acquireTransientButton(result.store, result.index);
+			}
+			if(button->getType() == EntryType::SYSTEM)
+			{
+				button->setShortcutKey(cell.result < 9 ? QString::number(cell.result + 1) : QString());
+			}
+		}
+		button->ensureIcon();
 		button->setVisible(true);
-		grid->addWidget(button, button->getRow(), button->getCol());
-		buttonsInGrid.append(button);
+		grid->addWidget(button, cell.row, cell.col);
+		this->buttonsInGrid.append(button);
+		inserted++;
 	}
+	if(this->nextPendingCell < this->pendingCells.size())
+	{
+		this->gridFillTimer.start();
+		return;
+	}
+	this->pendingCells.clear();
+	this->nextPendingCell = 0;
+
+	/* Whether the view is filled is only known after the layout, which comes before the timer */
+	QTimer::singleShot(0, this, [this] {
+		QScrollBar *scrollBar = this->scrollArea->verticalScrollBar();
+		if(this->pendingCells.isEmpty() && scrollBar->minimum() == scrollBar->maximum())
+		{
+			showMoreResults();
+		}
+	});
 }
 
 void Window::executeConfig(const EntryConfig &config)
 {
-	if(config.isTerminalCommand || QApplication::keyboardModifiers().testFlag(Qt::ShiftModifier))
+	PhaseScope phase("launching");
+	if(!config.commandLine.isEmpty())
 	{
-		QString cmd = settingsProvider->getTerminalCommand();
-		cmd.replace("%c", config.command);
-		QStringList args = QProcess::splitCommand(cmd);
-		QProcess::startDetached(args[0], args);
+		/* Right away, the window is about to close and a quit would drop a scheduled task */
+		this->commandHistory->record(config.commandLine);
+		QSharedPointer<CommandHistory> history = this->commandHistory;
+		TaskScheduler::instance().schedule(TaskScheduler::MAINTENANCE, [history] { history->compact(); });
 	}
-	else
+	launchEntry(config, settingsProvider->getTerminalCommand(),
+				QApplication::keyboardModifiers().testFlag(Qt::ShiftModifier));
+	this->closeWindow();
+}
+
+void Window::showEvent(QShowEvent *event)
+{
+	this->idleTrimTimer.stop();
+	this->idleTrimLevel = 0;
+	if(this->stallWatchdog)
 	{
-		QProcess::startDetached(config.command, config.arguments);
+		this->stallWatchdog->resume();
+	}
+	QWidget::showEvent(event);
+}
+
+void Window::hideEvent(QHideEvent *event)
+{
+	this->idleTrimLevel = 0;
+	this->idleTrimTimer.start(IDLE_TRIM_INTERVALS_MSECS[0]);
+	if(this->stallWatchdog)
+	{
+		this->stallWatchdog->pause();
+	}
+	QWidget::hideEvent(event);
+}
+
+QJsonObject Window::memoryReport() const
+{
+	QJsonObject report = MemoryAccounting::instance().toJson();
+	report["entries"] = this->entryStore->memoryReport();
+	report["query_cache"] = this->entrySearchProvider->memoryReport();
+	report["directory_listings"] = this->directoryLister.memoryReport();
+	if(!this->commandHistory.isNull())
+	{
+		report["history"] = this->commandHistory->memoryReport();
+	}
+
+	const QWidgetList widgets = QApplication::allWidgets();
+	int menus = static_cast<int>(std::count_if(widgets.begin(), widgets.end(),
+							  [](QWidget *widget) { return qobject_cast<QMenu *>(widget) != nullptr; }));
+	/* Buttons alive beyond the ones we know of are leaked */
+	report["widgets"] = QJsonObject{{"widgets", widgets.size()},
+									{"menus", menus},
+									{"entry_buttons", EntryPushButton::instanceCount()},
+									{"user_entry_buttons", this->userEntryButtons.size()},
+									{"system_entry_buttons",
+									 this->systemEntryButtons.size() - this->systemEntryButtons.count(nullptr)},
+									{"transient_buttons", this->transientButtons.size()},
+									{"buttons_in_grid", this->buttonsInGrid.size()},
+									{"pending_cells", this->pendingCells.size() - this->nextPendingCell}};
+
+	report["icons"] = QJsonObject{{"decoded_button_icons", EntryPushButton::resolvedIconCount()},
+								  {"pixmap_cache", PixmapCache::instance().memoryReport()},
+								  {"theme_index", IconThemeIndex::instance().memoryReport()},
+								  {"qpixmapcache_limit_kb", QPixmapCache::cacheLimit()}};
+	report["calculator"] = QJsonObject{{"plugin_loaded", CalculationEngine::isPluginLoaded()}};
+	return report;
+}
+
+/* Called while hidden, with increasing levels the longer we stay hidden. Only what can be
+ * restored cheaply is given up, the favourites stay as they are to be shown instantly */
+void Window::trimMemory(int level)
+{
+	Metrics::instance().add("memory.trims");
+	if(level >= 1)
+	{
+		/* Rendered again from the pixmap cache when they show up in results */
+		for(EntryPushButton *button : this->systemEntryButtons)
+		{
+			if(button != nullptr)
+			{
+				button->releaseIcon();
+			}
+		}
+		deleteIdleTransientButtons(0);
+		for(EntryPushButton *button : this->transientButtons)
+		{
+			button->releaseIcon();
+		}
+		QPixmapCache::clear();
+	}
+	if(level >= 2)
+	{
+		PixmapCache::instance().save();
+		this->directoryLister.clearCache();
+		this->searchResults.squeeze();
+#ifdef __GLIBC__
+		malloc_trim(0);
+#endif
 	}
-	this->closeWindow();
 }
 
 void Window::addToFavourites(const EntryConfig &config)
@@ -156,7 +589,7 @@ void Window::addToFavourites(const EntryConfig &config)
 	userConfig.entryPath = entryPath;
 	try
 	{
-		entryProvider->saveUserEntry(userConfig);
+		persistenceQueue.enqueue(userConfig.entryPath, entryProvider->serializeUserEntry(userConfig));
 	}
 	catch(std::exception &e)
 	{
@@ -168,18 +601,39 @@ void Window::addToFavourites(const EntryConfig &config)
 	but that's probably overkill. */
 	userConfig.update(config);
 	userConfig.key = "";
-	userEntryButtons.append(createEntryButton(userConfig));
+	QVector<EntryConfig> userEntries = entryStore->userEntries();
+	userEntries.append(userConfig);
+	setEntryStore(EntryStorePtr(new EntryStore(userEntries, entryStore->systemEntries())));
+	userEntryButtons.append(createEntryButton(entryStore, entryStore->userCount() - 1));
+	updateSearchableEntries();
 }
 
 void Window::deleteEntry(EntryConfig &config)
 {
+	/* A pending save must not bring it back */
+	persistenceQueue.flush();
 	this->entryProvider->deleteUserEntry(config);
 	initFromConfig();
 }
 
+bool Window::isBusy() const
+{
+	return this->systemEntriesLoading || !this->searchDispatcher.isIdle();
+}
+
+void Window::setResident(bool resident)
+{
+	this->resident = resident;
+	if(resident && !isVisible())
+	{
+		this->idleTrimLevel = 0;
+		this->idleTrimTimer.start(IDLE_TRIM_INTERVALS_MSECS[0]);
+	}
+}
+
 void Window::closeWindow()
 {
-	if(settingsProvider->singleInstanceMode())
+	if(this->resident || settingsProvider->singleInstanceMode())
 	{
 		this->lineEdit->setText("");
 		hide();
@@ -192,28 +646,28 @@ void Window::closeWindow()
 
 std::pair<int, int> Window::getNextFreeCell()
 {
-	/* Not the most efficient way perhaps but for now it'll do */
-	std::sort(userEntryButtons.begin(), userEntryButtons.end(), [](EntryPushButton *a, EntryPushButton *b) {
-		const EntryConfig &config_a = a->getEntryConfig();
-		const EntryConfig &config_b = b->getEntryConfig();
-		if(config_a.row < config_b.row)
+	/* Not the most efficient way perhaps but for now it'll do. Sorts a copy, as userEntryButtons
+	 * is kept in the order of the store */
+	QVector<EntryPushButton *> sortedButtons = userEntryButtons;
+	std::sort(sortedButtons.begin(), sortedButtons.end(), [](EntryPushButton *a, EntryPushButton *b) {
+		if(a->getRow() < b->getRow())
 		{
 			return true;
 		}
-		if(config_a.row > config_b.row)
+		if(a->getRow() > b->getRow())
 		{
 			return false;
 		}
-		return config_a.col < config_b.col;
+		return a->getCol() < b->getCol();
 	});
 
 	int expectedRow = 1;
 	int expectedCol = 1;
 	int maxCols = this->settingsProvider->getMaxCols();
-	for(EntryPushButton *current : userEntryButtons)
+	for(EntryPushButton *current : sortedButtons)
 	{
-		int currentRow = current->getEntryConfig().row;
-		int currentCol = current->getEntryConfig().col;
+		int currentRow = current->getRow();
+		int currentCol = current->getCol();
 
 		if(currentRow != expectedRow || currentCol != expectedCol)
 		{
@@ -232,49 +686,6 @@ std::pair<int, int> Window::getNextFreeCell()
 	return {expectedRow, expectedCol};
 }
 
-QStringList Window::generatePATHSuggestions(const QString &text)
-{
-	QStringList results;
-	QString pathVar = QProcessEnvironment::systemEnvironment().value("PATH", "/usr/bin/:/bin/:");
-	QStringList paths = pathVar.split(":");
-	for(const QString &path : paths)
-	{
-		QDirIterator it(path);
-		while(it.hasNext())
-		{
-			QFileInfo info(it.next());
-			if(info.isFile() && info.isExecutable())
-			{
-				QString entry = info.baseName();
-				if(entry.startsWith(text))
-				{
-					results.append(entry);
-				}
-			}
-		}
-	}
-	return results;
-}
-
-void Window::addPATHSuggestion(const QString &text)
-{
-	QStringList suggestions = generatePATHSuggestions(text);
-	if(suggestions.length() == 1)
-	{
-		EntryConfig e;
-		e.name = suggestions[0];
-		e.col = 0;
-		e.row = 0;
-		e.command = suggestions[0];
-		e.iconPath = suggestions[0];
-		e.type = EntryType::DYNAMIC;
-		EntryPushButton *button = createEntryButton(e);
-		clearGrid();
-		grid->addWidget(button, 0, 0);
-		buttonsInGrid.append(button);
-	}
-}
-
 void Window::clearGrid()
 {
 	int count = grid->count();
@@ -283,14 +694,23 @@ void Window::clearGrid()
 		auto item = grid->itemAt(0)->widget();
 		grid->removeWidget(item);
 		item->setVisible(false);
+		releaseTransientButton(static_cast<EntryPushButton *>(item));
 	}
 	buttonsInGrid.clear();
+	deleteIdleTransientButtons(MAX_IDLE_TRANSIENT_BUTTONS);
+	/* Abandons what was not inserted yet */
+	gridFillTimer.stop();
+	pendingCells.clear();
+	nextPendingCell = 0;
+	searchResults.clear();
+	shownResults = 0;
 }
 
-void Window::addCalcResult(const QString &expression)
+void Window::showCalcResult(const QString &expression, const QString &result)
 {
+	PhaseScope phase("showing calculation");
 	clearGrid();
-	currentCalculationResult = calcEngine.evaluate(expression);
+	currentCalculationResult = result;
 	QString labelText = expression + ": " + currentCalculationResult;
 	calculationResultLabel.setText(labelText);
 	calculationResultLabel.setVisible(true);
@@ -317,42 +737,85 @@ void Window::addCalcResult(const QString &expression)
 	grid->addWidget(&calculationResultLabel, 0, 0);
 }
 
-// main problem here there is no easy event compression (clearing emit queue and only processing the last one)
 void Window::lineEditTextChanged(QString text)
 {
-	if(text.length() >= 2)
+	MemoryAccounting::instance().keystroke();
+	if(text.isEmpty())
 	{
-		QString input = text.mid(1);
-		if(text[0] == '=')
+		searchDispatcher.cancel();
+		populateGrid(this->userEntryButtons);
+		return;
+	}
+	/* Results arrive through showSearchResults(), stale ones are dropped by the dispatcher */
+	searchDispatcher.search(text);
+}
+
+void Window::showSearchResults(const QVector<SearchResult> &results, bool append)
+{
+	if(!results.isEmpty() && results[0].kind == SearchResult::CALCULATION)
+	{
+		showCalcResult(results[0].expression, results[0].value);
+		return;
+	}
+	if(!append)
+	{
+		clearGrid();
+		this->searchResults = results;
+		showMoreResults();
+		return;
+	}
+	/* What is in the grid stays, unless a new result ranks before some of it. Then only the
+	 * cells from there on are laid out again, as many as were shown before */
+	const int shown = this->shownResults;
+	int from = shown;
+	if(shown > 0 && !results.isEmpty())
+	{
+		const SearchResult &best = *std::min_element(results.begin(), results.end());
+		from = std::upper_bound(this->searchResults.begin(), this->searchResults.begin() + shown, best) -
+			   this->searchResults.begin();
+	}
+	this->searchResults.append(results);
+	if(from < shown)
+	{
+		unshowResults(from);
+		showMoreResults(shown - from);
+	}
+	else if(this->pendingCells.isEmpty())
+	{
+		/* The view might not be full yet */
+		QScrollBar *scrollBar = this->scrollArea->verticalScrollBar();
+		if(scrollBar->minimum() == scrollBar->maximum())
 		{
-			addCalcResult(input);
-			return;
+			showMoreResults();
 		}
 	}
+}
 
-	filterGridFor(text);
-	if(this->grid->count() == 0)
+/* Takes the results from index from on out of the grid again, they are ordered anew with the unshown ones */
+void Window::unshowResults(int from)
+{
+	const int MAX_COLS = this->settingsProvider->getMaxCols();
+	for(int i = from; i < this->shownResults; i++)
 	{
-		addPATHSuggestion(text);
-		if(this->grid->count() == 0)
+		QLayoutItem *item = this->grid->itemAtPosition(i / MAX_COLS, i % MAX_COLS);
+		if(item != nullptr && item->widget() != nullptr)
 		{
-			QStringList arguments = text.split(" ");
-			EntryConfig e;
-			e.name = "Execute: " + text;
-			if(arguments.length() > 1)
-			{
-				e.arguments = arguments.mid(1);
-			}
-			e.command = arguments[0];
-			e.iconPath = "utilities-terminal";
-			e.type = EntryType::DYNAMIC;
-
-			EntryPushButton *button = createEntryButton(e);
-			clearGrid();
-			grid->addWidget(button, 0, 0);
-			buttonsInGrid.append(button);
+			EntryPushButton *button = static_cast<EntryPushButton *>(item->widget());
+			this->grid->removeWidget(button);
+			button->setVisible(false);
+			this->buttonsInGrid.removeOne(button);
+			releaseTransientButton(button);
 		}
 	}
+	for(int i = this->nextPendingCell; i < this->pendingCells.size(); i++)
+	{
+		if(this->pendingCells[i].result >= from)
+		{
+			this->pendingCells.resize(i);
+			break;
+		}
+	}
+	this->shownResults = from;
 }
 
 void Window::keyReleaseEvent(QKeyEvent *event)
@@ -385,7 +848,7 @@ void Window::keyPressEvent(QKeyEvent *event)
 
 		for(EntryPushButton *button : buttonsInGrid)
 		{
-			if(!button->getEntryConfig().key.isEmpty())
+			if(!button->getShortcutKey().isEmpty())
 			{
 				button->showShortcut();
 			}
@@ -404,91 +867,135 @@ void Window::keyPressEvent(QKeyEvent *event)
 	QWidget::keyPressEvent(event);
 }
 
-int Window::rankConfig(const EntryConfig &config, QString filter) const
+/* Adds the next page of results to the grid, or minimum results if that is more. Only
+ * the page is ordered, the results after it are left as they are */
+void Window::showMoreResults(int minimum)
 {
-	if(config.name.startsWith(filter, Qt::CaseInsensitive))
+	if(shownResults >= searchResults.size())
 	{
-		return 0;
+		return;
 	}
-	else if(config.command.startsWith(filter, Qt::CaseInsensitive))
+	/* Still busy with the previous page */
+	if(minimum == 0 && !this->pendingCells.isEmpty())
 	{
-		return 1;
+		return;
 	}
-	else if(config.name.contains(filter, Qt::CaseInsensitive))
+	const int MAX_COLS = this->settingsProvider->getMaxCols();
+	int end = std::min(searchResults.size(), shownResults + std::max(minimum, MAX_COLS * RESULT_PAGE_ROWS));
+	std::partial_sort(searchResults.begin() + shownResults, searchResults.begin() + end, searchResults.end());
+	for(int i = shownResults; i < end; i++)
 	{
-		return 2;
+		if(searchResults[i].kind == SearchResult::ENTRY)
+		{
+			this->pendingCells.append({nullptr, i, i / MAX_COLS, i % MAX_COLS});
+		}
 	}
-	else if(config.command.contains(filter, Qt::CaseInsensitive))
+	/* Only the first page starts at the top of the view */
+	int firstScreen = shownResults == 0 ? visibleRows() * MAX_COLS : 0;
+	shownResults = end;
+	fillGrid(firstScreen);
+}
+
+EntryPushButton *Window::acquireTransientButton(EntryStorePtr store, int index)
+{
+	if(!this->idleTransientButtons.isEmpty())
 	{
-		return 3;
+		EntryPushButton *button = this->idleTransientButtons.takeLast();
+		button->bind(store, index);
+		return button;
 	}
-	return -1;
+	EntryPushButton *button = createEntryButton(store, index);
+	this->transientButtons.insert(button);
+	return button;
 }
 
-void Window::filterGridFor(QString filter)
+/* Ignores buttons that are not transient */
+void Window::releaseTransientButton(EntryPushButton *button)
 {
-	if(filter.length() > 0)
+	if(this->transientButtons.contains(button))
 	{
-		clearGrid();
-		bool userEntryMatch = false;
-		for(EntryPushButton *button : this->userEntryButtons)
+		this->idleTransientButtons.append(button);
+	}
+}
+
+void Window::deleteIdleTransientButtons(int keep)
+{
+	while(this->idleTransientButtons.size() > keep)
+	{
+		EntryPushButton *button = this->idleTransientButtons.takeLast();
+		this->transientButtons.remove(button);
+		button->deleteLater();
+	}
+}
+
+/* Whether a button showing a needs to be updated to show b */
+static bool appearanceDiffers(const EntryConfig &a, const EntryConfig &b)
+{
+	return a.name != b.name || a.iconPath != b.iconPath || a.isTerminalCommand != b.isTerminalCommand ||
+		   a.row != b.row || a.col != b.col || a.key != b.key;
+}
+
+/* Maps the entries [begin, end) of the current store to buttons, reusing the previous buttons of
+ * the same entryPath. Only new entries get a new button (without create, nullptr), only changed ones
+ * are updated and the buttons of entries that are gone are deleted */
+QVector<EntryPushButton *> Window::reconcileEntryButtons(const QVector<EntryPushButton *> &previous, int begin,
+														 int end, bool create)
+{
+	QMultiHash<QString, EntryPushButton *> byPath;
+	byPath.reserve(previous.size());
+	for(EntryPushButton *button : previous)
+	{
+		if(button != nullptr)
 		{
-			if(button->getName().contains(filter, Qt::CaseInsensitive) ||
-			   button->getCommand().contains(filter, Qt::CaseInsensitive))
-			{
-				button->setVisible(true);
-				grid->addWidget(button, button->getRow(), button->getCol());
-				this->buttonsInGrid.append(button);
-				userEntryMatch = true;
-			}
+			byPath.insert(button->getEntryPath(), button);
 		}
-		if(!userEntryMatch)
+	}
+
+	QVector<EntryPushButton *> result;
+	result.reserve(end - begin);
+	for(int i = begin; i < end; i++)
+	{
+		const EntryConfig &config = this->entryStore->at(i);
+		EntryPushButton *button = byPath.take(config.entryPath);
+		if(button == nullptr)
 		{
-			QVector<RankedButton> rankedEntries;
-			int currow = 0;
-			int curcol = 0;
-			int i = 1;
-			const int MAX_COLS = this->settingsProvider->getMaxCols();
-			for(EntryPushButton *button : this->systemEntryButtons)
+			if(create)
 			{
-				int ranking = rankConfig(button->getEntryConfig(), filter);
-				if(ranking > -1)
-				{
-					RankedButton rb;
-					rb.button = button;
-					rb.ranking = ranking;
-					rankedEntries.append(rb);
-				}
-			}
-			std::sort(rankedEntries.begin(), rankedEntries.end(),
-					  [](const RankedButton &a, const RankedButton &b) -> bool { return a.ranking < b.ranking; });
-			for(RankedButton &rankedButton : rankedEntries)
-			{
-				EntryPushButton *button = rankedButton.button;
-				button->setVisible(true);
-				if(i < 10)
-				{
-					button->setShortcutKey(QString::number(i++));
-				}
-				grid->addWidget(button, currow, curcol++);
-				this->buttonsInGrid.append(button);
-				if(curcol == MAX_COLS)
-				{
-					curcol = 0;
-					++currow;
-				}
+				button = createEntryButton(this->entryStore, i);
 			}
 		}
+		else if(appearanceDiffers(button->getStoredEntryConfig(), config))
+		{
+			button->bind(this->entryStore, i);
+		}
+		else
+		{
+			button->rebind(this->entryStore, i);
+		}
+		result.append(button);
 	}
-	else
+
+	for(EntryPushButton *button : byPath)
 	{
-		populateGrid(this->userEntryButtons);
+		this->buttonsInGrid.removeAll(button);
+		for(PendingCell &cell : this->pendingCells)
+		{
+			if(cell.button == button)
+			{
+				cell = {nullptr, -1, 0, 0};
+			}
+		}
+		this->grid->removeWidget(button);
+		button->setVisible(false);
+		/* We might be called from within the button, e. g. from its context menu */
+		button->deleteLater();
 	}
+	return result;
 }
 
-EntryPushButton *Window::createEntryButton(const EntryConfig &entry)
+EntryPushButton *Window::createEntryButton(EntryStorePtr store, int index)
 {
-	EntryPushButton *button = new EntryPushButton(entry);
+	EntryPushButton *button = new EntryPushButton(store, index);
 	connect(button, &EntryPushButton::clicked, this, &Window::executeConfig);
 	connect(button, &EntryPushButton::addToFavourites, this, &Window::addToFavourites);
 	connect(button, &EntryPushButton::deleteRequested, this, &Window::deleteEntry);
@@ -503,6 +1010,22 @@ void Window::lineEditReturnPressed()
 		this->lineEdit->setText("");
 		return;
 	}
+	if(this->lineEdit->text() == "/metrics")
+	{
+		QString dump = QJsonDocument(Metrics::instance().toJson()).toJson(QJsonDocument::Indented);
+		qInfo().noquote() << dump;
+		QMessageBox::information(this, "Metrics", dump);
+		this->lineEdit->setText("");
+		return;
+	}
+	if(this->lineEdit->text() == "/memory")
+	{
+		QString dump = QJsonDocument(memoryReport()).toJson(QJsonDocument::Indented);
+		qInfo().noquote() << dump;
+		QMessageBox::information(this, "Memory", dump);
+		this->lineEdit->setText("");
+		return;
+	}
 
 	if(buttonsInGrid.length() > 0 && this->lineEdit->text().length() > 0)
 	{
@@ -513,7 +1036,99 @@ void Window::lineEditReturnPressed()
 
 void Window::setSystemConfig(const QVector<EntryConfig> &config)
 {
-	this->systemEntryButtons = generateEntryButtons(config);
+	PhaseScope phase("creating system entry buttons");
+	AllocationScope allocations(MemoryAccounting::ENTRIES);
+	this->entryStore.reset(new EntryStore(entryStore->userEntries(), config));
+	rebindEntryButtons(this->userEntryButtons, 0);
+	/* Thousands of them possibly, so only the existing ones are kept, new ones are created when shown */
+	this->systemEntryButtons =
+		reconcileEntryButtons(this->systemEntryButtons, entryStore->userCount(), entryStore->size(), false);
+	updateSearchableEntries();
+	/* All icons have been rendered by now, persist them for the next start */
+	TaskScheduler::instance().schedule(TaskScheduler::MAINTENANCE, [] { PixmapCache::instance().save(); });
+
+	/* Whatever was typed in the meantime is searched again, now with the system entries */
+	if(!this->lineEdit->text().isEmpty())
+	{
+		lineEditTextChanged(this->lineEdit->text());
+	}
+}
+
+/* Shell-like completion of the last word: command names from PATH for the first one, paths for
+ * anything else. Completes up to the common prefix of all candidates */
+void Window::completeLineEdit()
+{
+	const QString text = this->lineEdit->text();
+	const int wordStart = text.lastIndexOf(' ') + 1;
+	const QString word = text.mid(wordStart);
+	const bool isCommand = wordStart == 0 && !word.contains('/');
+	QStringList directories;
+	QString directoryPart;
+	QString prefix = word;
+	if(isCommand)
+	{
+		QString pathVar = QProcessEnvironment::systemEnvironment().value("PATH", "/usr/bin/:/bin/:");
+		directories = pathVar.split(":", Qt::SkipEmptyParts);
+	}
+	else
+	{
+		int slash = word.lastIndexOf('/');
+		directoryPart = word.left(slash + 1);
+		prefix = word.mid(slash + 1);
+		QString directory = directoryPart;
+		if(directory.startsWith('~'))
+		{
+			directory.replace(0, 1, QDir::homePath());
+		}
+		if(QDir::isRelativePath(directory))
+		{
+			/* Launched commands inherit our working directory */
+			directory = QDir::currentPath() + "/" + directory;
+		}
+		directories.append(QDir::cleanPath(directory));
+	}
+
+	this->directoryLister.list(directories, [this, text, wordStart, directoryPart, prefix,
+											 isCommand](const QVector<DirectoryLister::Entry> &entries) {
+		/* Typed on in the meantime */
+		if(this->lineEdit->text() != text)
+		{
+			return;
+		}
+		QMap<QString, bool> candidates;
+		for(const DirectoryLister::Entry &entry : entries)
+		{
+			if(!entry.name.startsWith(prefix) || (isCommand && !entry.isExecutable))
+			{
+				continue;
+			}
+			if(entry.name.startsWith('.') && !prefix.startsWith('.'))
+			{
+				continue;
+			}
+			candidates.insert(entry.name, entry.isDir);
+		}
+		if(candidates.isEmpty())
+		{
+			return;
+		}
+		QString completion = candidates.firstKey();
+		for(const QString &candidate : candidates.keys())
+		{
+			int common = 0;
+			while(common < completion.size() && common < candidate.size() && completion[common] == candidate[common])
+			{
+				common++;
+			}
+			completion.truncate(common);
+		}
+		if(candidates.size() == 1)
+		{
+			completion += candidates.first() ? "/" : " ";
+		}
+		this->lineEdit->setText(text.left(wordStart) + directoryPart + completion);
+		this->lineEdit->setCursorPosition(this->lineEdit->text().length());
+	});
 }
 
 bool Window::eventFilter(QObject *obj, QEvent *event)
@@ -525,12 +1140,7 @@ bool Window::eventFilter(QObject *obj, QEvent *event)
 			QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
 			if(keyEvent->key() == Qt::Key_Tab)
 			{
-				QStringList suggestions = generatePATHSuggestions(this->lineEdit->text());
-				if(suggestions.length() == 1)
-				{
-					this->lineEdit->setText(suggestions[0] + " ");
-					this->lineEdit->setCursorPosition(this->lineEdit->text().length() + 1);
-				}
+				completeLineEdit();
 				return true;
 			}
 		}
@@ -575,8 +1185,10 @@ void Window::dropEvent(QDropEvent *event)
 
 			try
 			{
-				this->entryProvider->saveUserEntry(buttonAtDrop->getEntryConfig());
-				this->entryProvider->saveUserEntry(buttonAtSource->getEntryConfig());
+				EntryConfig dropConfig = buttonAtDrop->getEntryConfig();
+				EntryConfig sourceConfig = buttonAtSource->getEntryConfig();
+				persistenceQueue.enqueue(dropConfig.entryPath, entryProvider->serializeUserEntry(dropConfig));
+				persistenceQueue.enqueue(sourceConfig.entryPath, entryProvider->serializeUserEntry(sourceConfig));
 			}
 			catch(std::exception &e)
 			{
@@ -26,6 +26,8 @@
 #include <QMessageBox>
 #include <QApplication>
 #include <QHash>
+#include <QJsonObject>
+#include <QSet>
 #include <QVector>
 #include <QThread>
 #include <QTreeWidget>
@@ -33,16 +35,17 @@
 #include <QMimeData>
 #include <QDebug>
 #include <QRect>
+#include <QScrollArea>
+#include <QTimer>
+#include "commandhistory.h"
+#include "directorylister.h"
 #include "entrypushbutton.h"
-#include "calculationengine.h"
+#include "entrysearchprovider.h"
+#include "entrystore.h"
+#include "persistencequeue.h"
+#include "searchdispatcher.h"
 #include "settingsprovider.h"
-
-class RankedButton
-{
-  public:
-	EntryPushButton *button = nullptr;
-	int ranking;
-};
+#include "stallwatchdog.h"
 
 class Window : public QWidget
 {
@@ -50,43 +53,94 @@ class Window : public QWidget
   protected:
 	void dragEnterEvent(QDragEnterEvent *event);
 	void dropEvent(QDropEvent *event);
+	void showEvent(QShowEvent *event);
+	void hideEvent(QHideEvent *event);
 
   private:
 	EntryProvider *entryProvider;
 	SettingsProvider *settingsProvider;
-	CalculationEngine calcEngine;
-	QString calculationresult;
+	SearchDispatcher searchDispatcher;
+	QSharedPointer<EntrySearchProvider> entrySearchProvider;
+	QSharedPointer<SearchProvider> fileSearchProvider;
+	QSharedPointer<SearchProvider> contentSearchProvider;
+	QScopedPointer<StallWatchdog> stallWatchdog;
+	EntryStorePtr entryStore{new EntryStore()};
+	PersistenceQueue persistenceQueue;
+	DirectoryLister directoryLister;
+	QSharedPointer<CommandHistory> commandHistory;
+	quint64 systemEntriesGeneration = 0;
+	bool systemEntriesLoading = false;
 	QVector<EntryPushButton *> userEntryButtons;
+	/* nullptr for entries that have not been shown yet */
 	QVector<EntryPushButton *> systemEntryButtons;
 	QVector<EntryPushButton *> buttonsInGrid;
+	QHash<QString, EntryPushButton *> buttonsByPath;
+	/* Buttons for results that are not part of the catalog (PATH, Execute, files), recycled on
+	 * every search. Those not in the grid wait in idleTransientButtons, see releaseTransientButton() */
+	QSet<EntryPushButton *> transientButtons;
+	QVector<EntryPushButton *> idleTransientButtons;
+	QVector<SearchResult> searchResults;
+	int shownResults = 0;
+	/* Buttons still to be put into the grid, either a button or the index of a search result */
+	struct PendingCell
+	{
+		EntryPushButton *button;
+		int result;
+		int row;
+		int col;
+	};
+	QVector<PendingCell> pendingCells;
+	int nextPendingCell = 0;
+	QTimer gridFillTimer;
+	/* Steps down memory use while hidden, see trimMemory() */
+	QTimer idleTrimTimer;
+	int idleTrimLevel = 0;
+	bool resident = false;
 	QLabel calculationResultLabel;
 	QString currentCalculationResult;
-	QString queuedFileSearch;
-	QString queuedContentSearch;
 	void initFromConfig();
+	void setupFileSearch(const SettingsSnapshot &settings);
+	void setupContentSearch(const SettingsSnapshot &settings);
+	void setupStallWatchdog(const SettingsSnapshot &settings);
+	void loadSystemEntries();
 	void createGui();
-	void filterGridFor(QString filter);
+	void showSearchResults(const QVector<SearchResult> &results, bool append);
+	void showMoreResults(int minimum = 0);
+	void unshowResults(int from);
+	void updateSearchableEntries();
 	void populateGrid(const QVector<EntryPushButton *> &list);
+	void fillGrid(int minimum);
+	int visibleRows() const;
 	void keyReleaseEvent(QKeyEvent *event);
-	QVector<EntryPushButton *> generateEntryButtons(const QVector<EntryConfig> &userEntryButtons);
+	QVector<EntryPushButton *> reconcileEntryButtons(const QVector<EntryPushButton *> &previous, int begin, int end,
+													 bool create = true);
+	EntryPushButton *systemEntryButton(int index);
+	void rebindEntryButtons(const QVector<EntryPushButton *> &buttons, int begin);
+	void setEntryStore(EntryStorePtr store);
 	void keyPressEvent(QKeyEvent *event);
 	void executeConfig(const EntryConfig &button);
 	void addToFavourites(const EntryConfig &button);
 	void deleteEntry(EntryConfig &config);
 	QLineEdit *lineEdit;
 	QGridLayout *grid;
-	EntryPushButton *createEntryButton(const EntryConfig &config);
+	QScrollArea *scrollArea;
+	EntryPushButton *createEntryButton(EntryStorePtr store, int index);
+	EntryPushButton *acquireTransientButton(EntryStorePtr store, int index);
+	void releaseTransientButton(EntryPushButton *button);
+	void deleteIdleTransientButtons(int keep);
+	void completeLineEdit();
 	void lineEditTextChanged(QString text);
-	void addPATHSuggestion(const QString &text);
 	void clearGrid();
-	void addCalcResult(const QString &expression);
+	void showCalcResult(const QString &expression, const QString &result);
 	void initTreeWidgets();
-	QStringList generatePATHSuggestions(const QString &text);
 	void closeWindow();
+	void trimMemory(int level);
+	QJsonObject memoryReport() const;
 	std::pair<int, int> getNextFreeCell();
-	int rankConfig(const EntryConfig &config, QString filter) const;
   private slots:
 	void lineEditReturnPressed();
+	void settingsChanged(QSharedPointer<const SettingsSnapshot> previous,
+						 QSharedPointer<const SettingsSnapshot> current);
 	void showCalculationResultContextMenu(const QPoint &point);
 
   public:
@@ -94,6 +148,10 @@ class Window : public QWidget
 	void setSystemConfig(const QVector<EntryConfig> &config);
 	bool eventFilter(QObject *obj, QEvent *event);
 	void focusInput();
+	/* Whether entries are still being loaded or searched */
+	bool isBusy() const;
+	/* Keep running when closed, to be shown again later (e. g. --daemon) */
+	void setResident(bool resident);
 	~Window();
 };
 